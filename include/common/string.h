@@ -41,6 +41,35 @@ bool phraseMatch(const char* haystack, const char* needle);
 inline bool phraseMatch(const std::string& haystack, const char* needle) { return phraseMatch(haystack.c_str(), needle); }
 inline bool phraseMatch(const std::string& haystack, const std::string& needle) { return phraseMatch(haystack.c_str(), needle.c_str()); }
 inline bool phraseMatch(const char* haystack, const std::string& needle) { return phraseMatch(haystack, needle.c_str()); }
+
+// one or more haystack phrases for phraseMatch(), split into lower-cased
+// words up front; matches() is true if the needle matches any phrase
+class PhraseTokens
+{
+public:
+	inline PhraseTokens() {}
+	inline explicit PhraseTokens(const std::string& phrase) { add(phrase); }
+
+	void add(const std::string& phrase);
+	inline void clear() { folded.clear(); words.clear(); phrases.clear(); }
+	inline bool empty() const { return phrases.empty(); }
+
+	bool matches(const char* needle) const;
+	inline bool matches(const std::string& needle) const { return matches(needle.c_str()); }
+
+	// append every word of every phrase
+	void getWords(std::vector<std::string>& out) const;
+
+private:
+	struct Word {
+		uint32 start;
+		uint32 length;
+	};
+
+	std::string folded; // lower-cased words, back to back
+	std::vector<Word> words;
+	std::vector<uint32> phrases; // one past the last word of each phrase
+};
 // match a string prefix
 // tests if chunk is a prefix of full; that is, "ret" is a prefix of "return",
 // but "turn" is not.
@@ -67,6 +96,7 @@ bool hasSuffix(const char* base, const char* suffix);
 std::vector<std::string>& explode(std::vector<std::string>& out, const std::string& string, char ch);
 std::string& implode(std::string& out, const std::vector<std::string>& list, char ch);
 std::string& capwords(std::string& out, const std::string& string);
+std::vector<std::string>& explodeWords(std::vector<std::string>& out, const std::string& string); // appends lower-cased words
 // and 'easy' versions there-of
 inline std::vector<std::string> explode(const std::string& string, char ch) { std::vector<std::string> tmp; return explode(tmp, string, ch); }
 inline std::string implode(const std::vector<std::string>& list, char ch) { std::string tmp; return implode(tmp, list, ch); }
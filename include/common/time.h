@@ -8,6 +8,8 @@
 #ifndef SOURCEMUD_COMMON_TIME_H
 #define SOURCEMUD_COMMON_TIME_H
 
+#include "common/types.h"
+
 // legacy cruft
 std::string timeToStr(time_t time);
 time_t strToTime(const std::string& str);
@@ -21,6 +23,9 @@ extern const std::string RFC_822_FORMAT;
 // format time using the given string
 std::string format(const std::string& format, time_t time = time(NULL));
 
+// monotonic clock in nanoseconds, for measuring intervals
+uint64 nsecs();
+
 } // namespace Time
 
 #endif
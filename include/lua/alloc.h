@@ -0,0 +1,62 @@
+/*
+ * Source MUD
+ * Copyright (C) 2000-2005  Sean Middleditch
+ * See the file COPYING for license details
+ * http://www.sourcemud.org
+ */
+
+#ifndef SOURCEMUD_LUA_ALLOC_H
+#define SOURCEMUD_LUA_ALLOC_H
+
+#include "common/types.h"
+
+// Allocator for the Lua state.  Lua tells the allocator the size of
+// every block it frees or resizes, so small blocks need no header:
+// each size class hands out blocks from 16k chunks and keeps freed
+// ones on a free list.  Chunks are kept for reuse rather than given
+// back, since the strings, tables and closures Lua churns through
+// come back just as quickly.  Blocks over MAX_SMALL go to realloc().
+//
+// An optional cap fails allocations that would grow the heap past
+// it, which Lua turns into a memory error in the running script.
+// The cap only applies inside Lua::pcall() and Lua::resume(); the
+// server's own pushes outside them can't handle the error, so they
+// always succeed.
+namespace Lua
+{
+	namespace Alloc
+	{
+		// largest block served from the pools
+		static const size_t MAX_SMALL = 256;
+
+		struct ClassStats {
+			size_t size; // block size
+			size_t live; // blocks in use
+			size_t chunks; // chunks carved so far
+			uint64 allocs;
+		};
+
+		// the lua_Alloc function
+		void* alloc(void* ud, void* ptr, size_t osize, size_t nsize);
+
+		// hard cap on bytes in use, 0 for none
+		void setLimit(size_t bytes);
+		size_t getLimit();
+
+		// the cap is enforced while this is non-zero; bumped by
+		// Lua::pcall() and Lua::resume()
+		extern int enforce;
+
+		// statistics
+		size_t getBytes(); // requested by Lua and in use
+		size_t getPeak();
+		size_t getReserved(); // chunk memory plus large blocks
+		uint64 getAllocs();
+		uint64 getFrees();
+		uint64 getDenied(); // failed because of the cap
+		size_t getClassCount();
+		const ClassStats& getClass(size_t index);
+	}
+}
+
+#endif
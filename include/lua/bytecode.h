@@ -0,0 +1,43 @@
+/*
+ * Source MUD
+ * Copyright (C) 2000-2005  Sean Middleditch
+ * See the file COPYING for license details
+ * http://www.sourcemud.org
+ *
+ * BYTECODE CACHE
+ * Keeps compiled Lua chunks on disk, as written by lua_dump(), so a
+ * script or macro is only parsed the first time the server sees it.
+ * Entries are named by an MD5 of a key that must cover everything the
+ * compiled chunk depends on: for a file, its path and contents; for a
+ * macro, its text.  Stale entries are simply never looked up again.
+ * A chunk that fails to load (a different Lua build, say) is treated
+ * as a miss and rewritten.  The cache lives in the lua_cache_dir
+ * directory; an empty setting turns it off.
+ */
+
+#ifndef SOURCEMUD_LUA_BYTECODE_H
+#define SOURCEMUD_LUA_BYTECODE_H
+
+#include "common/types.h"
+
+namespace Lua
+{
+	namespace Bytecode
+	{
+		// push the cached function for key; false if there is none
+		bool load(const std::string& key);
+
+		// write the function on top of the stack to the cache under
+		// key, leaving it on the stack
+		void store(const std::string& key);
+
+		// luaL_loadfile(), through the cache
+		int loadFile(const std::string& path);
+
+		// statistics
+		uint64 getHits();
+		uint64 getMisses();
+	}
+}
+
+#endif
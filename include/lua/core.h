@@ -9,6 +9,7 @@
 #define SOURCEMUD_LUA_CORE_H
 
 #include "common.h"
+#include "common/types.h"
 #include "common/imanager.h"
 
 struct lua_State;
@@ -23,6 +24,36 @@ namespace Lua {
 	// Load and execute a script file
 	bool runfile(const std::string& path);
 
+	// lua_pcall() the function on the stack, aborting it with an error
+	// once it runs more than max_instructions VM instructions or
+	// max_nsecs of wall time (0 for no limit).  sets *overran if the
+	// call was aborted for going over, but not for an overrun of an
+	// outer call it was made under.  calls may nest; a nested call
+	// gets no more than the outer one has left, and what it uses is
+	// charged to the outer one.  once over, the error is raised again
+	// on every instruction until the call returns, so the script can't
+	// catch it with its own pcall().
+	int pcall(int nargs, int nresults, uint64 max_instructions, uint64 max_nsecs, bool* overran = NULL);
+
+	// as above, using the lua_instructions and lua_time settings
+	int pcall(int nargs, int nresults, bool* overran = NULL);
+
+	// lua_resume() a coroutine under the default budget, capped as
+	// for pcall(), which starts over with each resume
+	int resume(lua_State* thread, int nargs, bool* overran = NULL);
+
+	// do incremental garbage collection for up to max_nsecs, while
+	// the server would otherwise sleep; returns the time spent
+	uint64 collectIdle(uint64 max_nsecs);
+
+	// collectIdle() statistics
+	uint64 getIdleGCTime();
+	uint64 getIdleGCSteps();
+	uint64 getIdleGCCycles();
+
+	// calls aborted for going over their budget
+	uint64 getOverrunCount();
+
 	// global stack (ick, but we need it)
 	extern lua_State *state;
 }
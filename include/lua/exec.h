@@ -36,8 +36,13 @@
  * the arguments are not kept between calls.  The cleanup() MUST be called
  * before reusing an Exec object.
  *
- * ExecHook is a sub-class that looks up a hook function set with the
- * mud.setHook function in Lua.
+ * The function runs under the lua_instructions and lua_time budgets
+ * unless setBudget() says otherwise; see Lua::pcall().
+ *
+ * ExecHook is a sub-class that calls a hook function set with the
+ * mud.setHook function in Lua; check Hooks::isSet() first.  It uses
+ * the hook's own budget, if the script gave one.  ExecRef calls a function held by a
+ * reference in the Lua registry (see luaL_ref).
  */
 
 #ifndef SOURCEMUD_LUA_EXEC_H
@@ -47,6 +52,7 @@
 
 #include "common/streams.h"
 #include "lua/object.h"
+#include "mud/hooks.h"
 
 namespace Lua {
 
@@ -82,6 +88,9 @@ public:
 	void param(const char* v) { param(v, strlen(v)); }
 	void param(const std::string& v) { param(v.c_str(), v.size()); }
 
+	// pushes an entity, or nil for NULL
+	void param(class Entity* entity);
+
 	// pushes any other object onto the stack
 	void param(void* object);
 
@@ -112,6 +121,10 @@ public:
 	// set our print handler
 	void setPrint(IStreamSink* stream) { print = stream; }
 
+	// limit the function to this many VM instructions and nanoseconds
+	// (0 for no limit)
+	void setBudget(uint64 instructions, uint64 nsecs) { max_instructions = instructions; max_nsecs = nsecs; has_budget = true; }
+
 	// pop any values from the stack; automatically done by the
 	// destructor.  this is used if you want to bail out early
 	// but the Exec object isn't going out of scope.
@@ -124,16 +137,30 @@ protected:
 	// passed to Lua::setPrint() when run() is called.
 	IStreamSink* print;
 
+	// budget from setBudget(); the default budget if !has_budget
+	uint64 max_instructions;
+	uint64 max_nsecs;
+	bool has_budget;
+
+	// the hook being called, for its statistics; COUNT if none
+	Hooks::HookID hook;
+
 	// just for ExecHook
 protected:
-	Exec() : stack(0), print(NULL) {}
+	Exec() : stack(0), print(NULL), max_instructions(0), max_nsecs(0), has_budget(false), hook(Hooks::COUNT) {}
 
 };
 
 class ExecHook : public Exec
 {
 public:
-	ExecHook(const std::string& hookname);
+	ExecHook(Hooks::HookID id);
+};
+
+class ExecRef : public Exec
+{
+public:
+	ExecRef(int ref);
 };
 
 } // namespace Lua
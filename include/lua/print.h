@@ -29,6 +29,9 @@
 namespace Lua {
 	// Set the current print handler
 	void setPrint(IStreamSink* sink);
+
+	// Get the current print handler, to restore after a nested call
+	IStreamSink* getPrint();
 }
 
 #endif
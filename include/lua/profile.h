@@ -0,0 +1,57 @@
+/*
+ * Source MUD
+ * Copyright (C) 2000-2005  Sean Middleditch
+ * See the file COPYING for license details
+ * http://www.sourcemud.org
+ *
+ * PROFILER
+ * Sampling profiler for scripts, switched on and off at run time with
+ * `admin profile'.  While it runs, the count hook Lua::pcall() and
+ * Lua::resume() install for budgets also samples the Lua stack every
+ * 1000 instructions.  Each sample is charged the time since the
+ * previous one (or since the call began), so functions get both a
+ * sample count and an estimate of their CPU time.  Hooks are timed
+ * exactly, all the time; the profiler reports what they used during
+ * its window.  Results can be written out as folded stacks, one
+ * "frame;frame;frame count" line per distinct stack, as flamegraph
+ * tools expect.
+ */
+
+#ifndef SOURCEMUD_LUA_PROFILE_H
+#define SOURCEMUD_LUA_PROFILE_H
+
+#include "common/types.h"
+
+struct lua_State;
+
+namespace Lua
+{
+	namespace Profile
+	{
+		extern bool running;
+
+		// start a new profile, discarding the last one, or stop
+		void start();
+		void stop();
+		inline bool isRunning() { return running; }
+
+		// a call from C into Lua begins; root names the outermost
+		// frame of its stacks, or is NULL to keep the current one.
+		// returns the previous root, for leave()
+		const char* enter(const char* root);
+		void leave(const char* old_root);
+
+		// take a sample of the running thread's stack
+		void sample(lua_State* s);
+
+		// write the top functions and the hooks to out
+		void report(std::ostream& out, size_t max_functions);
+
+		// write folded stacks to a file named after the profile_file
+		// setting and the current time; returns the path, or an empty
+		// string on error
+		std::string dump();
+	}
+}
+
+#endif
@@ -49,8 +49,15 @@ public:
 	virtual int apply(Creature* character) const = 0;
 	virtual void remove(Creature* character) const = 0;
 
+	// called whenever the group's duration is synchronized; that is
+	// every tick if isPeriodic(), otherwise only when the group (or
+	// another group on the same creature) expires
 	virtual void update(Creature* character) const = 0;
 
+	// affects that do something in update() over time should return
+	// true, so their creature is synchronized on every tick
+	virtual bool isPeriodic() const { return false; }
+
 	virtual ~ICreatureAffect() {}
 };
 
@@ -64,11 +71,13 @@ public:
 	int apply(Creature* character) const;
 	void remove(Creature* character) const;
 
-	void update(Creature* character);
+	// subtract elapsed ticks from the duration
+	void update(Creature* character, uint elapsed);
 
 	inline std::string getTitle() const { return title; }
 	inline CreatureAffectType getType() const { return type; }
 	inline uint getTimeLeft() const { return duration; }
+	inline bool isPeriodic() const { return periodic; }
 
 private:
 	typedef std::vector<ICreatureAffect*> AffectList;
@@ -77,6 +86,7 @@ private:
 	AffectList affects;
 	CreatureAffectType type;
 	uint duration;
+	bool periodic;
 };
 
 /* ACTUAL AFFECTS */
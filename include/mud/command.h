@@ -8,6 +8,7 @@
 #ifndef COMMAND_LINE_H
 #define COMMAND_LINE_H
 
+#include "common/types.h"
 #include "common/imanager.h"
 #include "mud/account.h"
 #include "mud/server.h"
@@ -86,10 +87,11 @@ private:
 	std::string name;
 	std::string usage;
 	AccessID access; // required permission
+	uint16 trace_name; // name id in the trace, 0 until first used
 
 public:
 	// constructor/destructor - virtual
-	inline Command(const std::string& s_name, const std::string& s_usage, AccessID s_access) : name(s_name), usage(s_usage), access(s_access)  {}
+	inline Command(const std::string& s_name, const std::string& s_usage, AccessID s_access) : name(s_name), usage(s_usage), access(s_access), trace_name(0)  {}
 
 	// basics
 	const std::string& getName() const { return name; }
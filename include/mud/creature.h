@@ -12,6 +12,7 @@
 #include "common/streams.h"
 #include "mud/body.h"
 #include "mud/entity.h"
+#include "mud/cstore.h"
 
 class IAction;
 
@@ -111,7 +112,9 @@ private:
 class Creature : public Entity, public IStreamSink
 {
 public:
-	Creature();
+	static const uint32 TYPE_MASK = E_TYPE_MASK(ET_NPC) | E_TYPE_MASK(ET_PLAYER);
+
+	explicit Creature(EntityType s_type);
 
 	// save/load
 	virtual int loadNode(File::Reader& reader, File::Node& node);
@@ -126,11 +129,11 @@ public:
 	CreaturePosition getPosition() const { return position; }
 	CreaturePosition setPosition(CreaturePosition p) { return position = p; }
 
-	// health
-	inline int getHP() const { return health.cur; }
-	inline int setHP(int new_hp) { return health.cur = new_hp; }  // NOTE: avoid use of, only necessary in rare cases
-	inline int getMaxHP() const { return health.max; }
-	inline int setMaxHP(int new_mhp) { return health.max = new_mhp; }  // NOTE: avoid use of
+	// health; stored in MCreatureStore
+	inline int getHP() const { return MCreatureStore.hp[slot]; }
+	inline int setHP(int new_hp) { return MCreatureStore.hp[slot] = new_hp; }  // NOTE: avoid use of, only necessary in rare cases
+	inline int getMaxHP() const { return MCreatureStore.max_hp[slot]; }
+	inline int setMaxHP(int new_mhp) { return MCreatureStore.max_hp[slot] = new_mhp; }  // NOTE: avoid use of
 
 	// check data
 	inline bool isDead() const { return dead; }
@@ -140,8 +143,8 @@ public:
 
 	// stats
 	virtual int getBaseStat(CreatureStatID stat) const = 0;
-	inline int getEffectiveStat(CreatureStatID stat) const { assert(stat); return effective_stats[stat.getValue()]; }
-	inline void setEffectiveStat(CreatureStatID stat, int val) { assert(stat); effective_stats[stat.getValue()] = val; }
+	inline int getEffectiveStat(CreatureStatID stat) const { assert(stat); return MCreatureStore.stats[stat.getValue()][slot]; }
+	void setEffectiveStat(CreatureStatID stat, int val);
 	int getStatModifier(CreatureStatID stat) const;
 
 	// combat
@@ -211,6 +214,10 @@ public:
 	// round time
 	uint getRoundTime() const;
 
+	// bring affect durations up to date and remove expired
+	// affects; called by MCreatureStore when one runs out
+	void updateAffects();
+
 	// action checks w/ error messages
 	bool checkAlive();  // must be alive
 	bool checkMove();  // can move
@@ -313,18 +320,25 @@ protected:
 		class Object* back_worn;
 		class Object* waist_worn;
 	} equipment;
-	struct {
-		int16 cur;
-		uint16 max;
-	} health; // hit points
+	// hit points, effective stats and round time live in
+	// MCreatureStore under this slot
+	uint32 slot;
 	bool dead;
 	CreaturePosition position;
-	CreatureStatArray effective_stats;
-	uint round_time; // round time
 	uint coins;
 	class Room* location;
 	ActionList actions;
 	AffectStatusList affects;
+
+	// round time of the current action
+	inline uint& roundTime() { return MCreatureStore.round_time[slot]; }
+	inline uint roundTime() const { return MCreatureStore.round_time[slot]; }
+
+	// keep the store's regeneration/activity masks in sync
+	void updateMasks();
+
+	virtual ~Creature();
+	friend class _MCreatureStore;
 };
 
 // stream out character descriptions
@@ -0,0 +1,72 @@
+/*
+ * Source MUD
+ * Copyright (C) 2000-2005  Sean Middleditch
+ * See the file COPYING for license details
+ * http://www.sourcemud.org
+ */
+
+#ifndef SOURCEMUD_MUD_CSTORE_H
+#define SOURCEMUD_MUD_CSTORE_H
+
+#include "common/types.h"
+#include "common/imanager.h"
+
+class Creature;
+
+// number of effective stats kept per creature; must match
+// CreatureStatID::COUNT (checked in cstore.cc)
+#define CSTORE_STAT_COUNT 6
+
+// Hot numeric creature state, stored as one array per field and
+// indexed by a per-creature slot.  The Creature accessors read and
+// write here.  Regeneration and affect timers are advanced once per
+// tick for every creature by a single flat loop in heartbeat(),
+// instead of by each Creature::heartbeat().
+class _MCreatureStore : public IManager
+{
+public:
+	virtual int initialize();
+	virtual void shutdown();
+
+	// advance regeneration and affect timers of all active creatures
+	void heartbeat();
+
+	// number of creatures in the store
+	inline size_t size() const { return owner.size(); }
+
+private:
+	// slot management, called by Creature
+	uint32 add(Creature* creature);
+	void remove(uint32 slot);
+
+	// recompute the regeneration rate from fortitude
+	void updateRegen(uint32 slot);
+
+	// one entry per slot
+	std::vector<Creature*> owner;
+	std::vector<int16> hp;
+	std::vector<uint16> max_hp;
+	std::vector<uint16> stats[CSTORE_STAT_COUNT];
+	std::vector<uint32> round_time;
+
+	// regeneration: regen_rate is added to regen_acc each tick,
+	// and every whole point (16.16 fixed point) heals one HP.
+	// regen_mask is all ones for active, living creatures.
+	std::vector<uint32> regen_rate;
+	std::vector<uint32> regen_acc;
+	std::vector<uint32> regen_mask;
+
+	// affects: ticks until the next affect group expires (0 if
+	// there are no affects, 1 if a group is periodic) and ticks
+	// elapsed since the affect durations were last synchronized.
+	// active_mask is all ones for active creatures.
+	std::vector<uint32> affect_due;
+	std::vector<uint32> affect_elapsed;
+	std::vector<uint32> active_mask;
+
+	friend class Creature;
+};
+
+extern _MCreatureStore MCreatureStore;
+
+#endif
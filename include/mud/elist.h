@@ -9,6 +9,8 @@
 #define SOURCEMUD_MUD_ELIST_H
 
 #include "common/error.h"
+#include "common/string.h"
+#include "mud/entity.h"
 
 // --- EList Definition ---
 template<class EntType>
@@ -96,4 +98,246 @@ EList<EntType>::match(const std::string& str, uint index, uint *matches)
 	return value;
 }
 
+// --- IndexedEList Definition ---
+
+// what an entity needs to know about the IndexedEList holding it
+class IIndexedEList
+{
+public:
+	// the entity's match words changed; see Entity::nameChanged()
+	virtual void reindex(Entity* ent) = 0;
+
+protected:
+	~IIndexedEList() {}
+};
+
+// An entity list for large, busy containers (room contents, object
+// children).  Each entity records which IndexedEList holds it and its
+// position there, so has() and remove() are O(1); an entity can be in
+// at most one IndexedEList at a time.  remove() moves the last entity
+// into the hole, so the order is insertion order only until the first
+// removal.  match() uses a keyword index, built on first use and kept
+// up to date by add(), remove() and reindex().  the index remembers
+// where it put each entity, so taking one out is O(1) too.
+template<class EntType>
+class IndexedEList : private std::vector<EntType*>, public IIndexedEList
+{
+	typedef std::vector<EntType*> vtype;
+
+public:
+	typedef typename vtype::const_iterator const_iterator;
+	typedef const_iterator iterator;
+
+	IndexedEList<EntType> () : index_valid(false) {}
+
+	inline const_iterator begin() const { return vtype::begin(); }
+	inline const_iterator end() const { return vtype::end(); }
+	inline size_t size() const { return vtype::size(); }
+	inline bool empty() const { return vtype::empty(); }
+	inline EntType* operator[] (size_t i) const { return vtype::operator[](i); }
+
+	void add(EntType* ent);
+	void remove(EntType* ent);
+	bool has(EntType* ent) const;
+	EntType* match(const std::string& str, uint index = 1, uint *matches = NULL);
+
+	virtual void reindex(Entity* ent);
+
+private:
+	// entity pointers are keyed to the list; no copies
+	IndexedEList<EntType> (const IndexedEList<EntType>&);
+	IndexedEList<EntType>& operator= (const IndexedEList<EntType>&);
+
+	void indexAdd(EntType* ent);
+	void indexRemove(EntType* ent);
+	void buildIndex();
+
+	// match word -> entities with that word, for match()
+	typedef std::map<std::string, std::vector<EntType*> > KeywordIndex;
+	KeywordIndex keywords;
+	bool index_valid;
+
+	// for each entity, by list position, where the index holds it:
+	// the word's entry and the position in that entry's vector
+	typedef std::vector<std::pair<typename KeywordIndex::iterator, size_t> > KeywordSlots;
+	std::vector<KeywordSlots> slots;
+};
+
+// --- IndexedEList Implementation ---
+
+template<class EntType>
+void
+IndexedEList<EntType>::add(EntType* ent)
+{
+	assert(ent != NULL);
+
+	// duplicate?  quit
+	if (ent->elist == this)
+		return;
+	assert(ent->elist == NULL);
+
+	ent->elist = this;
+	ent->elist_index = vtype::size();
+	vtype::push_back(ent);
+	slots.push_back(KeywordSlots());
+
+	indexAdd(ent);
+}
+
+template<class EntType>
+void
+IndexedEList<EntType>::remove(EntType* ent)
+{
+	assert(ent != NULL);
+	if (ent->elist != this)
+		return;
+
+	indexRemove(ent);
+
+	// move the last entity into the hole
+	size_t index = ent->elist_index;
+	assert(index < vtype::size() && vtype::operator[](index) == ent);
+	EntType* last = vtype::back();
+	vtype::operator[](index) = last;
+	last->elist_index = index;
+	vtype::pop_back();
+	slots[index].swap(slots.back());
+	slots.pop_back();
+
+	ent->elist = NULL;
+}
+
+template<class EntType>
+bool
+IndexedEList<EntType>::has(EntType* ent) const
+{
+	assert(ent != NULL);
+	return ent->elist == this;
+}
+
+template<class EntType>
+EntType*
+IndexedEList<EntType>::match(const std::string& str, uint index, uint *matches)
+{
+	assert(!str.empty());
+	assert(index != 0);
+
+	if (matches)
+		*matches = 0;
+
+	// the first word of the search has to be a prefix of one of the
+	// entity's match words, so those entities are the only candidates
+	std::vector<std::string> words;
+	explodeWords(words, str);
+	if (words.empty())
+		return NULL;
+	const std::string& first = words.front();
+
+	if (!index_valid)
+		buildIndex();
+
+	std::vector<std::pair<size_t, EntType*> > candidates;
+	for (typename KeywordIndex::const_iterator i = keywords.lower_bound(first); i != keywords.end() && !i->first.compare(0, first.size(), first); ++i)
+		for (typename std::vector<EntType*>::const_iterator e = i->second.begin(); e != i->second.end(); ++e)
+			candidates.push_back(std::make_pair((*e)->elist_index, *e));
+
+	// count matches in list order, so "2.sword" means the same thing
+	// it would when scanning the whole list
+	std::sort(candidates.begin(), candidates.end());
+	candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+	uint count = 0;
+	EntType* value = NULL;
+	for (typename std::vector<std::pair<size_t, EntType*> >::const_iterator i = candidates.begin(); i != candidates.end(); ++i)
+		if (i->second->nameMatch(str))
+			if (++count == index) {
+				value = i->second;
+				break;
+			}
+
+	if (matches)
+		*matches = count;
+
+	return value;
+}
+
+template<class EntType>
+void
+IndexedEList<EntType>::reindex(Entity* ent)
+{
+	assert(ent != NULL && ent->elist == this);
+
+	if (!index_valid)
+		return;
+
+	indexRemove(static_cast<EntType*>(ent));
+	indexAdd(static_cast<EntType*>(ent));
+}
+
+template<class EntType>
+void
+IndexedEList<EntType>::indexAdd(EntType* ent)
+{
+	if (!index_valid)
+		return;
+
+	std::vector<std::string> words;
+	ent->getMatchWords(words);
+
+	KeywordSlots& mine = slots[ent->elist_index];
+	for (std::vector<std::string>::const_iterator i = words.begin(); i != words.end(); ++i) {
+		typename KeywordIndex::iterator k = keywords.insert(std::make_pair(*i, std::vector<EntType*>())).first;
+		mine.push_back(std::make_pair(k, k->second.size()));
+		k->second.push_back(ent);
+	}
+}
+
+template<class EntType>
+void
+IndexedEList<EntType>::indexRemove(EntType* ent)
+{
+	if (!index_valid)
+		return;
+
+	// go by where we put the entity, not by its current words, which
+	// may have changed since
+	KeywordSlots& mine = slots[ent->elist_index];
+	for (typename KeywordSlots::const_iterator i = mine.begin(); i != mine.end(); ++i) {
+		typename KeywordIndex::iterator k = i->first;
+		std::vector<EntType*>& ents = k->second;
+
+		// move the last entity under this word into the hole, and
+		// point its slot at the new position
+		size_t last = ents.size() - 1;
+		if (i->second != last) {
+			EntType* moved = ents[last];
+			ents[i->second] = moved;
+			KeywordSlots& theirs = slots[moved->elist_index];
+			for (typename KeywordSlots::iterator s = theirs.begin(); s != theirs.end(); ++s)
+				if (s->first == k && s->second == last) {
+					s->second = i->second;
+					break;
+				}
+		}
+		ents.pop_back();
+
+		if (ents.empty())
+			keywords.erase(k);
+	}
+	mine.clear();
+}
+
+template<class EntType>
+void
+IndexedEList<EntType>::buildIndex()
+{
+	keywords.clear();
+	index_valid = true;
+
+	for (typename std::vector<KeywordSlots>::iterator i = slots.begin(); i != slots.end(); ++i)
+		i->clear();
+	for (typename vtype::const_iterator i = vtype::begin(); i != vtype::end(); ++i)
+		indexAdd(*i);
+}
+
 #endif
@@ -18,32 +18,55 @@
 #include "mud/clock.h"
 #include "mud/macro.h"
 #include "mud/name.h"
-#include "lua/object.h"
+#include "mud/pool.h"
+#include "mud/handle.h"
 
-// for the global entity list
-typedef std::list<Entity*> EntityList; // NOTE: no gc_alloc, don't want GC to scan this
+typedef std::vector<Entity*> EntityList;
 typedef std::set<TagID> TagList;
-typedef std::multimap<TagID, Entity*> TagTable; // NOTE: also non-GC scanning
 typedef std::vector<EventHandler*> EventList;
 
+// concrete entity types; the entity manager keeps a separate
+// active list for each
+enum EntityType {
+	ET_ROOM,
+	ET_PORTAL,
+	ET_OBJECT,
+	ET_NPC,
+	ET_PLAYER,
+	ET_COUNT
+};
+
+// set of entity types, for checked casts
+#define E_TYPE_MASK(type) (1U << (type))
+
 // --- Entity Definiton ---
 
 // entity control
 class Entity : public IMacroObject
 {
 public:
-	Entity();
+	// types E_CAST accepts for this class
+	static const uint32 TYPE_MASK = ~0U;
+
+	explicit Entity(EntityType s_type);
 
 	// factory handling
 	virtual const char* factoryType() const = 0;
+	inline EntityType entityType() const { return entity_type; }
 	static Entity* create(const std::string& type);  // efactory.cc
 
-	// Lua scripting support -- returns a userdata representing the
-	// Entity in question.
-	void pushLuaTable() const { return Lua::getObject((void*)this); }
+	// Lua scripting support -- pushes the userdata representing the
+	// Entity in question, creating it the first time a script needs it.
+	void pushLuaTable() const;
+
+	// pushes our full name as a Lua string, cached until nameChanged()
+	void pushLuaName() const;
+
+	// weak reference to this entity
+	inline EntityHandle getHandle() const { return handle; }
 
 	// name stuff
-	virtual EntityName getName() const = 0;
+	virtual const EntityName& getName() const = 0;
 
 	// description
 	virtual std::string getDesc() const = 0;
@@ -52,6 +75,16 @@ public:
 	inline const EventList& getEvents() const { return events; }
 	EventHandler* getEvent(EventID event);
 
+	// events we have handlers for or scripts waiting on.  handlers
+	// are only added at load time, before the entity is placed; waits
+	// come and go, and eventMaskChanged() tells whoever keeps counts
+	inline EventMask getEventMask() const { return event_mask | wait_mask; }
+	inline bool handlesEvent(EventID event) const { return getEventMask() & event.getMask(); }
+
+	// events scripts are waiting on; set by the scheduler
+	inline EventMask getWaitMask() const { return wait_mask; }
+	void setWaitMask(EventMask mask);
+
 	// active
 	inline bool isActive() const { return state == ACTIVE; }
 	virtual void activate(); // subclasses should call Entity::activate() first, then do custom code
@@ -84,6 +117,15 @@ public:
 	// check name
 	virtual bool nameMatch(const std::string& name) const;
 
+	// append the lower-cased words nameMatch() can match the first
+	// word of a search against; used to index lists by keyword
+	virtual void getMatchWords(std::vector<std::string>& words) const;
+
+	// call whenever our name or match words change (including through
+	// a new blueprint), so the list holding us can reindex us.
+	// blueprints are only edited while they load, before they are used
+	void nameChanged();
+
 	// event triggers
 	virtual void handleEvent(const Event& event);
 	virtual void broadcastEvent(const Event& event) = 0;
@@ -112,6 +154,10 @@ public:
 	virtual Entity* getOwner() const = 0;
 	virtual void ownerRelease(Entity* child) = 0;
 
+	// called after getEventMask() changes; by default updates the
+	// counts of the Room we're in, if any
+	virtual void eventMaskChanged(EventMask old_mask);
+
 	// various data
 protected:
 	TagList tags;
@@ -123,9 +169,36 @@ protected:
 	enum State { FLOAT, ACTIVE, DEAD } state;
 
 private:
-	// linked list tracking all entities
-	Entity* link_prev;
-	Entity* link_next;
+	// concrete type, set by the subclass constructor
+	const EntityType entity_type;
+
+	// one bit for each event in events, and the handler to run
+	// for each EventID; the table is empty if we have no handlers
+	EventMask event_mask;
+	std::vector<EventHandler*> event_table;
+	EventMask wait_mask;
+
+	void addEvent(EventHandler* handler);
+
+	// the IndexedEList holding this entity, and our position in it
+	class IIndexedEList* elist;
+	size_t elist_index;
+
+	// position in the entity manager's active or dead list
+	size_t registry_index;
+
+	// position in the entity manager's list for each tag; only
+	// filled in while active
+	typedef std::vector<std::pair<TagID, size_t> > TagSlots;
+	TagSlots tag_slots;
+
+	// our handle slot
+	EntityHandle handle;
+
+	// Lua registry references to our userdata and our name string
+	// (0 until first pushed)
+	mutable int lua_udata;
+	mutable int lua_name_ref;
 
 	// event handler
 	int performEvent(EventHandler *ea, Entity* trigger, Entity* target);
@@ -134,6 +207,7 @@ protected:
 	// protected destructor
 	virtual ~Entity();
 	friend class _MEntity;
+	template<class> friend class IndexedEList;
 };
 
 // manage all entities
@@ -153,25 +227,57 @@ public:
 	virtual void heartbeat();
 
 	// fetch by tag
-	std::pair<TagTable::const_iterator, TagTable::const_iterator> tagList(TagID tag) const;
+	const EntityList& tagList(TagID tag) const;
 
 	// count by tag
 	size_t tagCount(TagID tag) const;
 
-	// free all dead entities
-	void collect();
+	// number of distinct tags with at least one active entity
+	inline size_t tagListCount() const { return tag_map.size(); }
 
-private:
-	Entity* all;
-	Entity* dead;
+	// free dead entities, in no particular order; stops once
+	// max_nsecs have passed or max_count entities are freed (0 for no
+	// limit), but always frees at least one.  until an entity is
+	// freed its handle still resolves, so events queued for it are
+	// still delivered and scripts holding it can still use it
+	void collect(uint64 max_nsecs = 0, size_t max_count = 0);
+
+	// entities waiting for collect()
+	inline size_t getDeadCount() const { return dead.size(); }
 
-	// next entity we will be running the heartbeat for.
-	// we track this so that if both the current and next
-	// entities end up being moved to the dead list, we
-	// still iterate to the proper entity.
-	Entity* next;
+	// active entities of a given type
+	inline const EntityList& getActive(EntityType type) const { return active[type].list; }
 
-	// tag map: no GC
+private:
+	// active list for a single entity type.  while heartbeat() runs,
+	// entities in [0,cursor) have already been run, [cursor,end) are
+	// still pending, and [end,size) were activated during the pass and
+	// wait for the next one.  removal fills the hole from the same
+	// segment, so destroying entities mid-pass never skips or repeats
+	// a heartbeat.  outside of heartbeat(), cursor and end are 0.
+	struct ActiveList {
+		ActiveList() : cursor(0), end(0) {}
+
+		EntityList list;
+		size_t cursor;
+		size_t end;
+	};
+
+	void addActive(Entity* entity);
+	void removeActive(Entity* entity);
+	void addDead(Entity* entity);
+	void removeDead(Entity* entity);
+
+	// add/remove an active entity to/from a tag list
+	void addTagged(Entity* entity, TagID tag);
+	void removeTagged(Entity* entity, TagID tag);
+
+	ActiveList active[ET_COUNT];
+	EntityList dead;
+
+	// active entities for each tag; each entity remembers its
+	// position in the list, so removal is a swap-remove
+	typedef std::tr1::unordered_map<TagID, EntityList, TagID::Hash> TagTable;
 	TagTable tag_map;
 
 	// Entities have to be able to manage list - ick
@@ -182,7 +288,26 @@ extern _MEntity MEntity;
 
 // --- CASTING/TYPE-CHECKING ---
 
-#define E_CAST(ENT,TYPE) (dynamic_cast<TYPE*>((ENT)))
+// Casting compares the entity's type tag against the target class's
+// TYPE_MASK, so no RTTI lookup is needed.  Configure with
+// --enable-checked-casts to verify each cast against dynamic_cast.
+template <class T>
+inline T* entityCast(Entity* entity)
+{
+	T* result = entity != NULL && (T::TYPE_MASK & E_TYPE_MASK(entity->entityType())) ? static_cast<T*>(entity) : NULL;
+#ifdef CHECK_ENTITY_CASTS
+	assert(result == dynamic_cast<T*>(entity));
+#endif
+	return result;
+}
+
+template <class T>
+inline const T* entityCast(const Entity* entity)
+{
+	return entityCast<T>(const_cast<Entity*>(entity));
+}
+
+#define E_CAST(ENT,TYPE) (entityCast<TYPE>((ENT)))
 #define ENTITY(ENT) E_CAST(ENT,Entity)
 
 #endif
@@ -9,6 +9,7 @@
 #define EVENT_H
 
 #include "mud/fileobj.h"
+#include "mud/handle.h"
 
 /* external classes */
 class Room;
@@ -17,6 +18,9 @@ class Object;
 class Portal;
 class Zone;
 
+// set of EventIDs, one bit per ID
+typedef uint32 EventMask;
+
 class EventID
 {
 public:
@@ -45,6 +49,11 @@ public:
 	bool valid() const { return value != NONE; }
 	const std::string& getName() const { return names[value]; }
 	type_t getValue() const { return value; }
+	EventMask getMask() const { return 1U << value; }
+
+	// whether a notification identical to the one just queued for
+	// the same recipient is merged into it
+	bool coalesces() const { return coalesce[value]; }
 
 	static EventID lookup(const std::string& name);
 
@@ -55,39 +64,92 @@ private:
 	type_t value;
 
 	static std::string names[];
+	static const bool coalesce[];
 };
 
+// Counts how many entities in a set handle each event, so an owner
+// can tell in O(1) whether broadcasting an event to the set is of
+// any use.
+class EventSubscribers
+{
+public:
+	EventSubscribers() : mask(0) { for (int i = 0; i < EventID::COUNT; ++i) counts[i] = 0; }
+
+	// an entity with the given handler mask joined/left the set
+	inline void add(EventMask entity_mask)
+	{
+		for (int i = 1; entity_mask >> i; ++i)
+			if (entity_mask & (1U << i) && counts[i]++ == 0)
+				mask |= 1U << i;
+	}
+	inline void remove(EventMask entity_mask)
+	{
+		for (int i = 1; entity_mask >> i; ++i)
+			if (entity_mask & (1U << i) && --counts[i] == 0)
+				mask &= ~(1U << i);
+	}
+
+	// events at least one entity in the set handles
+	inline EventMask getMask() const { return mask; }
+
+private:
+	EventMask mask;
+	uint32 counts[EventID::COUNT];
+};
+
+// A script run when an entity receives an event.  The script is
+// compiled once, when loaded, into a Lua function that gets the
+// event name, the recipient and the event's aux entities as
+// arguments.
 class EventHandler
 {
 protected:
 	EventID event;
 	std::string script;
+	int func; // Lua registry reference from _MEvent::compile()
 
 public:
 	EventHandler();
+	~EventHandler();
 
 	int load(File::Reader& reader);
 	void save(File::Writer& writer) const;
 
 	EventID getEvent() const { return event; }
+
+	// run the handler for an event sent to self
+	void run(Entity* self, const class Event& event) const;
+
+private:
+	// holds a reference to a compiled function; no copies
+	EventHandler(const EventHandler&);
+	EventHandler& operator= (const EventHandler&);
 };
 
-// should only be stack allocated
+// queued events hold handles, so entities destroyed before the
+// event is processed simply resolve to NULL
 class Event
 {
 public:
 	EventID getId() const { return id; }
 
-	Entity* getRecipient() const { return recipient; }
-	Entity* getAux1() const { return aux1; }
-	Entity* getAux2() const { return aux2; }
+	Entity* getRecipient() const { return recipient.get(); }
+	Entity* getAux1() const { return aux1.get(); }
+	Entity* getAux2() const { return aux2.get(); }
+	Entity* getAux3() const { return aux3.get(); }
+
+	bool operator== (const Event& event) const
+	{
+		return id == event.id && recipient == event.recipient && aux1 == event.aux1 &&
+			aux2 == event.aux2 && aux3 == event.aux3;
+	}
 
 private:
 	EventID id;
-	Entity* recipient;
-	Entity* aux1;
-	Entity* aux2;
-	Entity* aux3;
+	EntityHandle recipient;
+	EntityHandle aux1;
+	EntityHandle aux2;
+	EntityHandle aux3;
 
 	friend class _MEvent;
 };
@@ -95,6 +157,8 @@ private:
 class _MEvent : public IManager
 {
 public:
+	_MEvent() : head(0), queued(0), pushed(0), popped(0), peak(0), coalesced(0) {}
+
 	// initialize manager
 	virtual int initialize();
 
@@ -119,18 +183,70 @@ public:
 
 	void resend(const Event& event, Entity* recipient);
 
+	// broadcast to all rooms in a zone
+	void broadcast(
+	    EventID id,
+	    Zone* zone,
+	    Entity* aux1 = 0,
+	    Entity* aux2 = 0,
+	    Entity* aux3 = 0
+	);
+
 	// return true if there are pending events
-	bool eventsPending() { return !events.empty(); }
+	bool eventsPending() { return queued != 0; }
 
-	// compile an event handler script
+	// queue statistics
+	inline size_t getQueued() const { return queued; }
+	inline size_t getPeak() const { return peak; }
+	inline uint64 getProcessed() const { return popped; }
+	inline uint64 getCoalesced() const { return coalesced; }
+
+	// compile an event handler script, returning a Lua registry
+	// reference to the function, or LUA_NOREF on error.  handlers
+	// with identical source share one function; each compile()
+	// must be paired with a release() of the same source.
 	int compile(EventID id, const std::string& source, const std::string& filename, unsigned long fileline);
+	void release(const std::string& source);
+
+	// number of distinct compiled handler functions
+	inline size_t getCompiledCount() const { return compiled.size(); }
 
-	// process events
-	void process();
+	// process the events queued so far, stopping once max_nsecs
+	// have passed or max_count events are done (0 for no limit);
+	// the rest wait for the next call
+	void process(uint64 max_nsecs = 0, size_t max_count = 0);
 
 private:
-	typedef std::deque<Event> EQueue;
-	EQueue events;
+	// queue an event for its recipient
+	void push(const Event& event);
+
+	// pending events, in a ring buffer whose size is a power of
+	// two; it grows by doubling and never shrinks, so queueing
+	// doesn't allocate once the server has warmed up
+	std::vector<Event> ring;
+	size_t head;
+	size_t queued;
+
+	// events queued and processed since startup; an event's sequence
+	// number is the value of pushed when it was queued, so it is still
+	// in the ring at head + (seq - popped) while seq >= popped
+	uint64 pushed;
+	uint64 popped;
+
+	// sequence number plus one of the last event queued for each
+	// handle slot, for coalescing
+	std::vector<uint64> last_queued;
+
+	size_t peak;
+	uint64 coalesced;
+
+	// compiled handlers by source
+	struct Compiled {
+		int ref;
+		size_t users;
+	};
+	typedef std::map<std::string, Compiled> CompiledMap;
+	CompiledMap compiled;
 };
 extern _MEvent MEvent;
 
@@ -0,0 +1,61 @@
+/*
+ * Source MUD
+ * Copyright (C) 2000-2005  Sean Middleditch
+ * See the file COPYING for license details
+ * http://www.sourcemud.org
+ */
+
+#ifndef SOURCEMUD_MUD_HANDLE_H
+#define SOURCEMUD_MUD_HANDLE_H
+
+#include "common/types.h"
+
+class Entity;
+
+// Weak reference to an entity.  A handle is a slot in a global table
+// plus the generation the slot had when the handle was taken.  The
+// generation is bumped when the entity is freed, so a stale handle
+// resolves to NULL instead of dangling.  Queued events, Lua userdata
+// and anything else held across ticks should keep a handle rather
+// than an Entity pointer.  Slot 0 is reserved, so a default
+// constructed handle is always null.
+class EntityHandle
+{
+public:
+	inline EntityHandle() : slot(0), generation(0) {}
+
+	// resolve the handle; NULL if the entity has been freed.  a
+	// destroyed entity still resolves until MEntity.collect() frees it
+	inline Entity* get() const
+	{
+		const Slot& s = slots[slot];
+		return s.generation == generation ? s.entity : NULL;
+	}
+
+	inline uint32 getSlot() const { return slot; }
+	inline uint32 getGeneration() const { return generation; }
+
+	inline bool operator== (const EntityHandle& h) const { return slot == h.slot && generation == h.generation; }
+	inline bool operator!= (const EntityHandle& h) const { return !(*this == h); }
+
+	// called by Entity's constructor and destructor
+	static EntityHandle acquire(Entity* entity);
+	static void release(EntityHandle handle);
+
+	// slots in use, including free ones
+	static size_t getSlotCount() { return slots.size(); }
+
+private:
+	struct Slot {
+		Entity* entity;
+		uint32 generation;
+	};
+
+	uint32 slot;
+	uint32 generation;
+
+	static std::vector<Slot> slots;
+	static std::vector<uint32> free_slots;
+};
+
+#endif
@@ -8,6 +8,8 @@
 #ifndef SOURCEMUD_MUD_HOOKS_H
 #define SOURCEMUD_MUD_HOOKS_H
 
+#include "common/types.h"
+
 class Room;
 class Entity;
 class Object;
@@ -21,6 +23,62 @@ namespace File { class Writer; }
 
 namespace Hooks
 {
+	// hooks scripts can set with mud.setHook
+	enum HookID {
+		SAVE_CREATURE,
+		CREATURE_HEARTBEAT,
+		SAVE_ENTITY,
+		SAVE_PORTAL,
+		READY,
+		CHANGE_HOUR,
+		SAVE_NPC,
+		NPC_DEATH,
+		NPC_HEARTBEAT,
+		SAVE_OBJECT_BLUEPRINT,
+		SAVE_OBJECT,
+		OBJECT_HEARTBEAT,
+		SAVE_PLAYER,
+		PLAYER_START,
+		CREATE_CREATURE,
+		PLAYER_DEATH,
+		PLAYER_HEARTBEAT,
+		SAVE_ROOM,
+		ROOM_HEARTBEAT,
+		SHOW_ROOM,
+		SAVE_ZONE,
+		HTTP_REQUEST,
+		COUNT
+	};
+
+	// per hook: Lua registry reference to the function (0 while no
+	// script has set it), its budget if has_budget (0 for no limit;
+	// the defaults otherwise), calls made so far, time spent in them,
+	// calls aborted for going over budget, and its trace name id
+	struct Slot {
+		int ref;
+		bool has_budget;
+		uint64 max_instructions;
+		uint64 max_nsecs;
+		uint64 calls;
+		uint64 nsecs;
+		uint64 overruns;
+		uint16 trace_name;
+	};
+	extern Slot slots[COUNT];
+
+	// a hook that isn't set costs this one test
+	inline bool isSet(HookID id) { return slots[id].ref != 0; }
+
+	// hook names, as given to mud.setHook; lookup() returns COUNT
+	// for unknown names
+	const char* getName(HookID id);
+	HookID lookup(const std::string& name);
+
+	// set a hook to the function on top of the Lua stack, which is
+	// popped, replacing any previous function and budget; without
+	// has_budget, calls get the default budget
+	void set(HookID id, bool has_budget = false, uint64 max_instructions = 0, uint64 max_nsecs = 0);
+
 	bool saveCreature(Creature* self, File::Writer& writer);
 	bool creatureHeartbeat(Creature* self);
 	bool saveEntity(Entity* self, File::Writer& writer);
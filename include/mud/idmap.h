@@ -55,6 +55,11 @@ public:
 	bool operator< (const BaseID<tag>& cmp) const { return id < cmp.id; }
 	bool operator== (const BaseID<tag>& cmp) const { return id == cmp.id; }
 
+	// hash functor, for unordered containers
+	struct Hash {
+		size_t operator()(const BaseID<tag>& key) const { return std::tr1::hash<const std::string*>()(key.id); }
+	};
+
 protected:
 	const std::string* id;
 
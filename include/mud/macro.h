@@ -8,6 +8,7 @@
 #ifndef SOURCEMUD_MUD_MACRO_H
 #define SOURCEMUD_MUD_MACRO_H
 
+#include "common/types.h"
 #include "common/streams.h"
 
 class MacroValue;
@@ -58,6 +59,17 @@ private:
 
 namespace macro {
 	bool text(const StreamControl& stream, const std::string& format, const MacroArgs& argv);
+
+	// compiled macro cache statistics
+	size_t getCacheSize();
+	size_t getCacheNative(); // of those, rendered without Lua
+	uint64 getCacheHits();
+	uint64 getCacheMisses();
+	uint64 getCacheEvictions();
+
+	// compile the macros in the messages, zones and blueprints that
+	// need Lua into the bytecode cache; returns how many were compiled
+	int precompile();
 }
 
 // macro info
@@ -19,8 +19,10 @@ public:
 
 	std::string get(const std::string& id);
 
-private:
 	typedef std::tr1::unordered_map<std::string, std::string> MessageMap;
+	inline const MessageMap& getMessages() const { return messages; }
+
+private:
 	MessageMap messages;
 };
 extern _MMessage MMessage;
@@ -8,6 +8,8 @@
 #ifndef MUD_NAME_H
 #define MUD_NAME_H
 
+#include "common/string.h"
+
 class EntityArticleClass
 {
 public:
@@ -63,28 +65,30 @@ class EntityName
 public:
 	inline EntityName() : text(), article(EntityArticleClass::NORMAL) {}
 	inline EntityName(EntityArticleClass s_article, const std::string& s_text) :
-			text(s_text), article(s_article) {}
+			text(s_text), article(s_article), tokens(s_text) {}
 
 	// these handle full names with articles
 	std::string getFull() const;
 	bool setFull(const std::string& s_name);  // returns false if it had to guess at the article
 
 	// compare name to string
-	bool matches(const std::string& match) const;  // returns true on match; uses phrase_match
+	inline bool matches(const std::string& match) const { return tokens.matches(match); } // same rules as phraseMatch
+	inline const PhraseTokens& getTokens() const { return tokens; }
 
 	// these handle name components
-	inline std::string getText() const { return text; }
+	inline const std::string& getText() const { return text; }
 	inline EntityArticleClass getArticle() const { return article; }
-	inline void setText(const std::string& s_text) { text = s_text; }
+	void setText(const std::string& s_text);
 	inline void setArticle(EntityArticleClass s_article) { article = s_article; }
 
 	inline bool empty() const { return text.empty(); }
 
-	inline bool operator < (const EntityName& ref) { return strcasecmp(text.c_str(), ref.text.c_str()) < 0; }
+	inline bool operator < (const EntityName& ref) const { return strcasecmp(text.c_str(), ref.text.c_str()) < 0; }
 
 private:
 	std::string text;
 	EntityArticleClass article;
+	PhraseTokens tokens; // text, pre-split for matches()
 };
 
 class Entity;
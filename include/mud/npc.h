@@ -36,6 +36,7 @@ public:
 	void resetName();
 
 	inline const std::vector<std::string>& getKeywords() const { return keywords; }
+	inline const PhraseTokens& getKeywordTokens() const { return keyword_tokens; }
 
 	// description
 	inline const std::string& getDesc() const { return desc; }
@@ -71,6 +72,7 @@ private:
 	EntityName name;
 	std::string desc;
 	std::vector<std::string> keywords;
+	PhraseTokens keyword_tokens;
 	GenderType gender;
 	CreatureStatArray base_stats;
 	NpcBP* parent;
@@ -102,8 +104,11 @@ private:
 class Npc : public Creature
 {
 public:
+	static const uint32 TYPE_MASK = E_TYPE_MASK(ET_NPC);
+
 	Npc();
 	Npc(NpcBP* s_blueprint);
+	E_POOL_DECL
 
 	virtual const char* factoryType() const { return "npc"; }
 
@@ -113,9 +118,10 @@ public:
 	static Npc* loadBlueprint(const std::string& name);
 
 	// name info
-	virtual EntityName getName() const;
+	virtual const EntityName& getName() const;
 
 	virtual bool nameMatch(const std::string& name) const;
+	virtual void getMatchWords(std::vector<std::string>& words) const;
 
 	// description
 	virtual std::string getDesc() const;
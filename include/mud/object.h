@@ -91,10 +91,11 @@ public:
 	inline bool isAnonymous() const { return id.empty(); }
 
 	// name
-	virtual EntityName getName() const;
+	virtual const EntityName& getName() const;
 	bool setName(const std::string& s_name);
 
 	const std::vector<std::string>& getKeywords() const { return keywords; }
+	const PhraseTokens& getKeywordTokens() const { return keyword_tokens; }
 
 	// description
 	const std::string& getDesc() const { return desc; }
@@ -137,6 +138,7 @@ private:
 	uint cost;
 	EquipSlot equip;
 	std::vector<std::string> keywords;
+	PhraseTokens keyword_tokens;
 	TagList tags;
 
 	// flags
@@ -151,8 +153,11 @@ class
 Object : public Entity
 {
 public:
+	static const uint32 TYPE_MASK = E_TYPE_MASK(ET_OBJECT);
+
 	Object();
 	Object(ObjectBP* s_blueprint);
+	E_POOL_DECL
 
 	// factory name
 	virtual const char* factoryType() const { return "object"; }
@@ -167,8 +172,9 @@ public:
 
 	// name info
 	bool setName(const std::string&);
-	EntityName getName() const;
+	const EntityName& getName() const;
 	bool nameMatch(const std::string& name) const;
+	virtual void getMatchWords(std::vector<std::string>& words) const;
 
 	// description
 	std::string getDesc() const;
@@ -239,7 +245,7 @@ private:
 	uint calc_weight; // calculated weight of children objects
 	uint trash_timer; // ticks until trashed
 
-	EList<Object> children; // child objects
+	IndexedEList<Object> children; // child objects
 
 	// weight tracking
 	void recalcWeight();
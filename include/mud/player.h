@@ -25,8 +25,11 @@
 class Player : public Creature
 {
 public:
+	static const uint32 TYPE_MASK = E_TYPE_MASK(ET_PLAYER);
+
 	// create and initialize
 	Player(std::tr1::shared_ptr<class Account> s_account, const std::string& s_id);
+	E_POOL_DECL
 
 	virtual const char* factoryType() const { return "player"; }
 
@@ -34,7 +37,7 @@ public:
 	inline std::string getId() const { return name.getText(); }
 
 	// name information (special for players)
-	inline virtual EntityName getName() const { return name; }
+	inline virtual const EntityName& getName() const { return name; }
 
 	// description information
 	virtual inline std::string getDesc() const { return std::string(); }
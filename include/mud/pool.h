@@ -0,0 +1,86 @@
+/*
+ * Source MUD
+ * Copyright (C) 2000-2005  Sean Middleditch
+ * See the file COPYING for license details
+ * http://www.sourcemud.org
+ */
+
+#ifndef SOURCEMUD_MUD_POOL_H
+#define SOURCEMUD_MUD_POOL_H
+
+#include "common/types.h"
+
+// Slab allocator for entities.  Each concrete Entity class gets its
+// own pool of fixed-size blocks carved out of large slabs, so the
+// constant churn of spawned NPCs and objects doesn't fragment the
+// general heap.  Freed blocks are not reused immediately; they are
+// queued until _MEntity::collect() calls EntityPool::collectAll(),
+// which hands them back to their slabs in one batch and releases any
+// slabs that ended up completely empty.
+class EntityPool
+{
+public:
+	EntityPool(const char* s_name, size_t s_size);
+	~EntityPool();
+
+	// allocate or free a single object
+	void* allocate(size_t size);
+	void release(void* ptr, size_t size);
+
+	// return pending frees to their slabs
+	void collect();
+
+	// statistics
+	inline const char* getName() const { return name; }
+	inline size_t getObjectSize() const { return object_size; }
+	inline size_t getSlabCount() const { return slab_count; }
+	inline size_t getSlabSize() const { return per_slab; }
+	inline size_t getLive() const { return live; }
+	inline size_t getPeak() const { return peak; }
+	inline size_t getPending() const { return pending.size(); }
+	inline uint64 getAllocs() const { return allocs; }
+	inline uint64 getFrees() const { return frees; }
+
+	// all registered pools
+	static const std::vector<EntityPool*>& getPools() { return *pools(); }
+
+	// run collect() on every pool
+	static void collectAll();
+
+private:
+	struct Slab;
+	struct Block;
+
+	void grow();
+	void freeSlab(Slab* slab);
+
+	const char* name;
+	size_t object_size; // size of the pooled class
+	size_t block_size; // object plus block header, aligned
+	size_t per_slab; // blocks per slab
+
+	Slab* partial; // slabs with at least one free block
+	std::vector<void*> pending; // released, not yet returned
+
+	size_t slab_count;
+	size_t live;
+	size_t peak;
+	uint64 allocs;
+	uint64 frees;
+
+	static std::vector<EntityPool*>* pools();
+};
+
+// declare pooled allocation for an entity class; must appear in a
+// public section of the class declaration
+#define E_POOL_DECL \
+	static void* operator new (size_t size); \
+	static void operator delete (void* ptr, size_t size);
+
+// define the pool for an entity class; goes in the class' source file
+#define E_POOL_IMPL(klass) \
+	namespace { EntityPool _pool_##klass(#klass, sizeof(klass)); } \
+	void* klass::operator new (size_t size) { return _pool_##klass.allocate(size); } \
+	void klass::operator delete (void* ptr, size_t size) { _pool_##klass.release(ptr, size); }
+
+#endif
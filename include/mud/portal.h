@@ -128,13 +128,16 @@ public:
 class Portal : public Entity
 {
 public:
+	static const uint32 TYPE_MASK = E_TYPE_MASK(ET_PORTAL);
+
 	Portal();
+	E_POOL_DECL
 
 	virtual const char* factoryType() const { return "portal"; }
 
 	// name information
-	virtual EntityName getName() const;
-	bool setName(const std::string& s_name) { return name.setFull(s_name); }
+	virtual const EntityName& getName() const;
+	bool setName(const std::string& s_name) { bool ret = name.setFull(s_name); nameChanged(); return ret; }
 	void addKeyword(const std::string& keyword);
 
 	// description information
@@ -146,7 +149,8 @@ public:
 
 	// the taget room and portal (target portal is the portal you come out of)
 	std::string getTarget() const { return target; }
-	void setTarget(const std::string& t) { target = t; }
+	void setTarget(const std::string& t) { target = t; target_entry = NULL; }
+	class Room* getTargetRoom() const;
 
 	// movement messages based on usage/detail
 	std::string getGo() const;
@@ -163,6 +167,9 @@ public:
 	virtual void handleEvent(const Event& event);
 	virtual void broadcastEvent(const Event& event);
 
+	// a two-way portal is counted in its target room as well
+	virtual void eventMaskChanged(EventMask old_mask);
+
 	// activate/deactivtee
 	virtual void activate();
 	virtual void deactivate();
@@ -229,11 +236,16 @@ protected:
 	EntityName name;
 	std::string desc;
 	std::string target;
+
+	// target's room index entry, looked up on first use; it follows
+	// the target id's rooms by itself
+	mutable const struct RoomIndexEntry* target_entry;
 	PortalDir dir;
 	PortalUsage usage;
 	PortalDetail detail;
 	class Room* parent_room;
 	std::vector<std::string> keywords;
+	PhraseTokens keyword_tokens;
 
 	// flags
 	struct Flags {
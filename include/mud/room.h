@@ -19,18 +19,21 @@ class Creature;
 class Room : public Entity
 {
 public:
+	static const uint32 TYPE_MASK = E_TYPE_MASK(ET_ROOM);
+
 	// nasty public stuff
-	EList<Object> objects;
-	EList<Creature> creatures;
+	IndexedEList<Object> objects;
+	IndexedEList<Creature> creatures;
 	std::map<PortalDir, Portal*> portals;
 
 	Room();
+	E_POOL_DECL
 
 	virtual const char* factoryType() const { return "room"; }
 
 	// name information
-	inline virtual EntityName getName() const { return name; }
-	inline void setName(const std::string& s_name) { name.setFull(s_name); }
+	inline virtual const EntityName& getName() const { return name; }
+	inline void setName(const std::string& s_name) { name.setFull(s_name); nameChanged(); }
 
 	// description information
 	inline virtual std::string getDesc() const { return desc; }
@@ -61,7 +64,7 @@ public:
 
 	// identifier
 	inline std::string getId() const { return id; }
-	inline void setId(const std::string& new_id) { id = new_id; }
+	void setId(const std::string& new_id);
 
 	// colour type
 	virtual const char* ncolor() const { return CTITLE; }
@@ -109,6 +112,22 @@ public:
 	virtual void handleEvent(const Event& event);
 	virtual void broadcastEvent(const Event& event);
 
+	// events handled by anything broadcastEvent() reaches
+	inline EventMask getSubscriberMask() const { return subscribers.getMask(); }
+
+	// a child's event mask changed
+	inline void updateSubscriber(EventMask old_mask, EventMask new_mask)
+	{
+		subscribers.remove(old_mask);
+		subscribers.add(new_mask);
+	}
+
+	// tell the zone, which broadcasts to rooms
+	virtual void eventMaskChanged(EventMask old_mask);
+
+	// leaves the room index as well
+	virtual void destroy();
+
 	// owner management - see entity.h
 	virtual void setOwner(Entity* owner);
 	virtual void ownerRelease(Entity* child);
@@ -130,6 +149,9 @@ char outdoors:
 		1;
 	} flags;
 
+	// handler counts over our objects, creatures and portals
+	EventSubscribers subscribers;
+
 protected:
 	~Room();
 
@@ -0,0 +1,129 @@
+/*
+ * Source MUD
+ * Copyright (C) 2000-2005  Sean Middleditch
+ * See the file COPYING for license details
+ * http://www.sourcemud.org
+ */
+
+#ifndef SOURCEMUD_MUD_SCHEDULER_H
+#define SOURCEMUD_MUD_SCHEDULER_H
+
+#include "common/types.h"
+#include "common/imanager.h"
+#include "mud/handle.h"
+#include "mud/event.h"
+
+struct lua_State;
+
+// Runs script functions started with mud.spawn as Lua coroutines that
+// can span ticks.  A thread parks itself with mud.sleep, which puts it
+// on a timer queue, or mud.waitEvent, which makes the entity it waits
+// on listen for the events; either way it costs nothing until it is
+// resumed.  A thread may belong to an entity, and is killed when that
+// entity is destroyed or freed.  Threads waiting on an entity that is
+// destroyed or freed are woken as if their wait timed out.
+class _MScheduler : public IManager
+{
+public:
+	_MScheduler() : resumed(0) {}
+
+	virtual int initialize();
+	virtual void shutdown();
+
+	// start the function below nargs arguments on top of s as a new
+	// thread owned by owner (or nobody, if NULL), and run it until it
+	// first parks or finishes.  pops the function and arguments.
+	void spawn(lua_State* s, int nargs, Entity* owner);
+
+	// park the running thread s; these return false if s isn't a
+	// thread we started.  the caller must then lua_yield(s, 0).  the
+	// thread only parks once that yield reaches us, so a yield that
+	// fails (inside a pcall()) leaves no timer or wait behind.
+	bool sleep(lua_State* s, uint32 ticks);
+	bool waitEvent(lua_State* s, Entity* entity, EventMask events, uint32 timeout_ticks);
+
+	// resume threads whose sleep or wait timeout is up; called once
+	// per tick, after MUD::getTicks() moves on
+	void update();
+
+	// resume threads waiting on the event's recipient
+	inline void deliver(Entity* recipient, const Event& event)
+	{
+		if (!waiters.empty())
+			wake(recipient, event);
+	}
+
+	// kill threads the entity owns and time out waits on it.  from
+	// the entity's destructor, pass freeing to leave the entity alone
+	void cancel(Entity* entity, bool freeing = false);
+
+	// statistics; the timer queue may still hold entries for threads
+	// that were woken early or killed
+	inline size_t getThreadCount() const { return by_state.size(); }
+	inline size_t getTimerCount() const { return timers.size(); }
+	inline size_t getWaitingCount() const { return waiters.size(); }
+	inline uint64 getResumed() const { return resumed; }
+
+private:
+	struct Thread {
+		lua_State* state; // NULL if the slot is free
+		int ref; // Lua registry reference keeping the thread alive
+		EntityHandle owner;
+		bool owned;
+		EntityHandle waiting; // entity of a waitEvent, if any
+		EventMask events;
+		uint32 generation; // bumped on every park, to expire timers
+		bool parked; // asked to park by the call it is yielding from
+		uint32 park_ticks; // and the timer and wait that asked for
+		EntityHandle park_on;
+		EventMask park_events;
+		bool running;
+		bool killed; // killed while running; free when it yields
+	};
+
+	// timer queue entry; stale once the thread's generation moves on
+	struct Timer {
+		uint64 wake;
+		uint32 thread;
+		uint32 generation;
+
+		bool operator< (const Timer& timer) const { return wake > timer.wake; }
+	};
+
+	typedef std::multimap<uint32, uint32> SlotMap; // handle slot -> thread
+
+	// start or continue a thread with nargs values on its stack
+	void resume(uint32 id, int nargs);
+
+	// drop a thread's event wait, updating the entity's event mask
+	// unless the entity is being freed
+	void unwait(uint32 id, bool freeing = false);
+
+	// free a thread
+	void kill(uint32 id);
+
+	// resume threads waiting on recipient for this event
+	void wake(Entity* recipient, const Event& event);
+
+	// thread id for a running Lua thread, or -1
+	int find(lua_State* s) const;
+
+	// park a thread that has yielded with the timer and wait its
+	// sleep() or waitEvent() asked for
+	void park(uint32 id);
+
+	std::vector<Thread> threads;
+	std::vector<uint32> free_threads;
+	std::map<lua_State*, uint32> by_state;
+
+	// min-heap on wake tick
+	std::vector<Timer> timers;
+
+	SlotMap waiters; // by waited-on entity
+	SlotMap owned; // by owner
+
+	uint64 resumed;
+};
+extern _MScheduler MScheduler;
+
+#endif
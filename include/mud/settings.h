@@ -34,6 +34,8 @@ public:
 	SETTING_STRING(LogFile, log_file)
 	SETTING_STRING(HttpLogFile, http_log_file)
 	SETTING_STRING(PidFile, pid_file)
+	SETTING_STRING(TraceFile, trace_file)
+	SETTING_STRING(ProfileFile, profile_file)
 	SETTING_STRING(DenyFile, deny_file)
 	SETTING_STRING(StateFile, state_file)
 	SETTING_STRING(ConfigFile, config_file)
@@ -45,6 +47,7 @@ public:
 	SETTING_STRING(PlayerPath, player_path)
 	SETTING_STRING(HelpPath, help_path)
 	SETTING_STRING(ScriptsPath, scripts_path)
+	SETTING_STRING(LuaCachePath, lua_cache_path)
 	SETTING_STRING(DbPath, db_path)
 	SETTING_STRING(MiscPath, misc_path)
 	SETTING_STRING(HtmlPath, html_path)
@@ -64,6 +67,18 @@ public:
 	SETTING_INT(CharactersPerAccount, characters_per_account)
 	SETTING_INT(ActivePerAccount, active_per_account)
 	SETTING_INT(AutoSave, auto_save)
+	SETTING_INT(CollectTime, collect_time)
+	SETTING_INT(CollectCount, collect_count)
+	SETTING_INT(EventTime, event_time)
+	SETTING_INT(EventCount, event_count)
+	SETTING_INT(TraceOverrun, trace_overrun)
+	SETTING_INT(LuaInstructions, lua_instructions)
+	SETTING_INT(LuaTime, lua_time)
+	SETTING_INT(LuaMemory, lua_memory)
+	SETTING_INT(LuaGcIdle, lua_gc_idle)
+	SETTING_INT(LuaGcPause, lua_gc_pause)
+	SETTING_INT(LuaGcStepmul, lua_gc_stepmul)
+	SETTING_INT(MacroCache, macro_cache)
 	SETTING_INT(TelnetTimeout, telnet_timeout)
 	SETTING_INT(HttpTimeout, http_timeout)
 	SETTING_BOOL(Daemon, daemon)
@@ -72,6 +87,7 @@ public:
 	SETTING_BOOL(BackupPlayers, backup_players)
 	SETTING_BOOL(BackupAccounts, backup_accounts)
 	SETTING_BOOL(BackupZones, backup_zones)
+	SETTING_BOOL(Precompile, precompile)
 
 private:
 	std::tr1::unordered_map<std::string, SettingInfo*> by_name;
@@ -0,0 +1,70 @@
+/*
+ * Source MUD
+ * Copyright (C) 2000-2005  Sean Middleditch
+ * See the file COPYING for license details
+ * http://www.sourcemud.org
+ */
+
+#ifndef SOURCEMUD_MUD_TRACE_H
+#define SOURCEMUD_MUD_TRACE_H
+
+#include "common/types.h"
+#include "common/time.h"
+
+// Always-on trace of what the server did recently: tick boundaries,
+// delivered events, command dispatches, Lua hook calls and idle Lua
+// garbage collection.  Records go into a fixed ring that overwrites
+// the oldest entries, so there is no allocation and no I/O until the
+// ring is dumped, either by `admin trace dump', by SIGUSR1, or
+// automatically when a tick runs long.  The ring is only touched from
+// the main loop; the signal handler merely asks for a dump.
+// tools/trace-decode.pl prints a dump.
+//
+// Dump format, in native byte order: the magic "SMTRACE1", then
+// uint32 record size, uint32 name count, uint32 record count, then
+// each name as a uint16 length and its bytes, then the records,
+// oldest first.  Name 0 is the empty string.
+namespace Trace
+{
+	enum Type {
+		NONE = 0,
+		TICK,       // arg: tick number
+		TICK_END,   // arg: tick duration in microseconds
+		EVENT,      // name: event, arg: recipient handle slot
+		COMMAND,    // name: command, arg: actor handle slot
+		HOOK,       // name: hook
+		GC,         // arg: idle Lua GC time in microseconds
+	};
+
+	struct Record {
+		uint64 nsecs;
+		uint16 type;
+		uint16 name;
+		uint32 arg;
+	};
+
+	// must be a power of two
+	static const size_t RING_SIZE = 1 << 16;
+
+	extern Record ring[RING_SIZE];
+	extern uint64 next; // records written so far
+
+	inline void record(Type type, uint16 name = 0, uint32 arg = 0)
+	{
+		Record& r = ring[next++ & (RING_SIZE - 1)];
+		r.nsecs = Time::nsecs();
+		r.type = type;
+		r.name = name;
+		r.arg = arg;
+	}
+
+	// id for a name in the dump's name table; callers should cache
+	// the result.  returns 0 once the table is full.
+	uint16 intern(const std::string& name);
+
+	// write the ring to a file named after the trace_file setting and
+	// the current time; returns the path, or an empty string on error
+	std::string dump();
+}
+
+#endif
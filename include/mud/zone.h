@@ -64,9 +64,15 @@ public:
 	// manage rooms
 	void addRoom(class Room*);
 
+	// a room handles new events
+	inline void addRoomEvents(EventMask mask) { room_events |= mask; }
+
 	// events
 	void broadcastEvent(const Event& event);
 
+	// events handled by any of our rooms
+	inline EventMask getSubscriberMask() const { return room_events; }
+
 	// load/save
 	int load(const std::string& path);
 	void save();
@@ -91,12 +97,26 @@ protected:
 	typedef std::vector<class Room*> RoomList;
 	RoomList rooms;
 
+	// union of our rooms' event masks; only ever grows, as a stale
+	// bit just costs one wasted pass over the rooms
+	EventMask room_events;
+
 	typedef std::vector<Spawn> SpawnList;
 	SpawnList spawns;
 
 	friend class _MZone;
 };
 
+// rooms sharing a lower-cased id.  the first one indexed is the one
+// found; when it is unindexed the next one takes over.  entries stay
+// put until shutdown, so a pointer to one always sees the current room
+struct RoomIndexEntry
+{
+	std::vector<class Room*> rooms;
+
+	inline class Room* getRoom() const { return rooms.empty() ? NULL : rooms.front(); }
+};
+
 class _MZone : public IManager
 {
 public:
@@ -112,6 +132,15 @@ public:
 	Zone* getZoneAt(size_t index);
 	class Room* getRoom(const std::string&);
 
+	// room id index, kept up to date by Zone and Room
+	void indexRoom(class Room* room);
+	void unindexRoom(class Room* room);
+
+	// the index entry for an id, created if there is none yet, for
+	// anything (like Portal's target) that looks the same id up over
+	// and over; NULL for an empty id
+	const RoomIndexEntry* getRoomEntry(const std::string& id);
+
 	// send an announcement to all the rooms in all the zones
 	void announce(const std::string&, AnnounceFlags = ANFL_NONE);
 
@@ -125,10 +154,15 @@ private:
 	typedef std::vector<Zone*> ZoneList;
 	ZoneList zones;
 
+	// rooms by lower-cased id
+	typedef std::tr1::unordered_map<std::string, RoomIndexEntry> RoomMap;
+	RoomMap room_map;
+
 	friend void Zone::destroy();
 };
 extern _MZone MZone;
 
-#define ZONE(ent) E_CAST(ent,Zone)
+// Zone is not an Entity, so this can only ever be a cross-cast
+#define ZONE(ent) (dynamic_cast<Zone*>((ent)))
 
 #endif
@@ -3,38 +3,41 @@
 -- See the file COPYING for license details
 -- http://www.sourcemud.org
 
--- support code for the macro facility
-macro = {
-	-- uppercase the first letter of text, for the ^ operator
-	raise = function(str)
-		return string.upper(string.sub(str, 1, 1)) .. string.sub(str, 2, -1)
-	end,
+-- support code for the macro facility; the server has already put
+-- macro.put, macro.property and macro.default in the table
 
-	-- return a variable value by name
-	lookup = function(name)
-		return 'LOOKUP[' .. name .. ']'
-	end,
+-- uppercase the first letter of text, for the ^ operator; objects
+-- raise their default text, as in natively rendered macros
+macro.raise = function(str)
+	if type(str) == 'userdata' then
+		str = macro.default(str)
+	end
+	if type(str) ~= 'string' then
+		return str
+	end
+	return string.upper(string.sub(str, 1, 1)) .. string.sub(str, 2, -1)
+end
 
-	-- invoke a built-in function/value
-	invoke = function(name, ...)
-		-- look up the built-in
-		local what = macro.builtins[name]
-		-- evaluate function
-		if type(what) == 'function' then
-			return what(...)
-		-- return static value
-		elseif what ~= nil then
-			return what
-		-- error case
-		else
-			return '[[unknown function \'' .. name .. '\']]'
-		end
-	end,
+-- invoke a built-in function/value
+macro.invoke = function(name, ...)
+	-- look up the built-in
+	local what = macro.builtins[name]
+	-- evaluate function
+	if type(what) == 'function' then
+		return what(...)
+	-- return static value
+	elseif what ~= nil then
+		return what
+	-- error case
+	else
+		return '[[unknown function \'' .. name .. '\']]'
+	end
+end
 
-	-- list of built-ins
-	builtins = {
-		bold = function(str) return "\027!C14!", str, "\027!C0!" end,
-		version = VERSION,
-		build = BUILD
-	}
+-- list of built-ins.  objects passed to them are only good until the
+-- macro returns; using one kept from an earlier macro raises an error
+macro.builtins = {
+	bold = function(str) return "\027!C14!", str, "\027!C0!" end,
+	version = VERSION,
+	build = BUILD
 }
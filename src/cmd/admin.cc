@@ -13,6 +13,16 @@
 #include "mud/player.h"
 #include "mud/zone.h"
 #include "mud/account.h"
+#include "mud/pool.h"
+#include "mud/hooks.h"
+#include "mud/scheduler.h"
+#include "mud/clock.h"
+#include "mud/macro.h"
+#include "lua/core.h"
+#include "lua/alloc.h"
+#include "lua/bytecode.h"
+#include "lua/profile.h"
+#include "mud/trace.h"
 
 /* BEGIN COMMAND
  *
@@ -110,3 +120,142 @@ void command_admin_blockip(Player* admin, std::string argv[])
 	}
 	*/
 }
+
+/* BEGIN COMMAND
+ *
+ * name: admin stats
+ *
+ * format: admin stats (80)
+ *
+ * access: ADMIN
+ *
+ * END COMMAND */
+void command_admin_stats(Player* admin, std::string[])
+{
+	char buffer[160];
+
+	// entity pools
+	*admin << CADMIN "Entity pools:" CNORMAL "\n";
+	snprintf(buffer, sizeof(buffer), "  %-7s %5s %6s %6s %5s %8s %8s %5s\n",
+			"Type", "Size", "Live", "Peak", "Slabs", "Allocs", "Frees", "Pend");
+	*admin << buffer;
+	const std::vector<EntityPool*>& pools = EntityPool::getPools();
+	for (std::vector<EntityPool*>::const_iterator i = pools.begin(); i != pools.end(); ++i) {
+		snprintf(buffer, sizeof(buffer), "  %-7s %5lu %6lu %6lu %5lu %8llu %8llu %5lu\n",
+				(*i)->getName(), (unsigned long)(*i)->getObjectSize(),
+				(unsigned long)(*i)->getLive(), (unsigned long)(*i)->getPeak(),
+				(unsigned long)(*i)->getSlabCount(),
+				(unsigned long long)(*i)->getAllocs(), (unsigned long long)(*i)->getFrees(),
+				(unsigned long)(*i)->getPending());
+		*admin << buffer;
+	}
+
+	// entity manager
+	*admin << CADMIN "Entities:" CNORMAL "\n";
+	*admin << "  Tags in use: " << MEntity.tagListCount() << "\n";
+	*admin << "  Awaiting collection: " << MEntity.getDeadCount() << "\n";
+
+	// event queue
+	*admin << CADMIN "Events:" CNORMAL "\n";
+	*admin << "  Queued: " << MEvent.getQueued() << " (peak " << MEvent.getPeak() << ")\n";
+	*admin << "  Processed: " << MEvent.getProcessed() << "\n";
+	*admin << "  Coalesced: " << MEvent.getCoalesced() << "\n";
+	*admin << "  Compiled handlers: " << MEvent.getCompiledCount() << "\n";
+
+	// scheduled script threads
+	*admin << CADMIN "Script threads:" CNORMAL "\n";
+	*admin << "  Running: " << MScheduler.getThreadCount() << "\n";
+	*admin << "  Waiting on events: " << MScheduler.getWaitingCount() << "\n";
+	*admin << "  Timers queued: " << MScheduler.getTimerCount() << "\n";
+	*admin << "  Resumed: " << MScheduler.getResumed() << "\n";
+
+	// Lua heap
+	*admin << CADMIN "Lua heap:" CNORMAL "\n";
+	*admin << "  In use: " << Lua::Alloc::getBytes() / 1024 << "k (peak " << Lua::Alloc::getPeak() / 1024 << "k";
+	if (Lua::Alloc::getLimit() != 0)
+		*admin << ", cap " << Lua::Alloc::getLimit() / 1024 << "k";
+	*admin << ")\n";
+	*admin << "  Reserved: " << Lua::Alloc::getReserved() / 1024 << "k\n";
+	ulong rounds = MUD::getRounds() ? MUD::getRounds() : 1;
+	*admin << "  Allocs: " << Lua::Alloc::getAllocs() << " (" << Lua::Alloc::getAllocs() / rounds << "/round)"
+			<< ", frees: " << Lua::Alloc::getFrees() << ", denied: " << Lua::Alloc::getDenied() << "\n";
+	*admin << "  Bytecode cache: " << Lua::Bytecode::getHits() << " hits, " << Lua::Bytecode::getMisses() << " misses\n";
+	*admin << "  Macro cache: " << macro::getCacheSize() << " loaded (" << macro::getCacheNative() << " native), " << macro::getCacheHits() << " hits, "
+			<< macro::getCacheMisses() << " misses, " << macro::getCacheEvictions() << " evicted\n";
+	ulong ticks = MUD::getTicks() ? MUD::getTicks() : 1;
+	*admin << "  Idle GC: " << Lua::getIdleGCCycles() << " cycles, " << Lua::getIdleGCSteps() << " steps, "
+			<< Lua::getIdleGCTime() / 1000000 << "ms (" << Lua::getIdleGCTime() / 1000 / ticks << "us/tick)\n";
+	snprintf(buffer, sizeof(buffer), "  %5s %8s %6s %10s\n", "Size", "Live", "Chunks", "Allocs");
+	*admin << buffer;
+	for (size_t i = 0; i < Lua::Alloc::getClassCount(); ++i) {
+		const Lua::Alloc::ClassStats& stats = Lua::Alloc::getClass(i);
+		snprintf(buffer, sizeof(buffer), "  %5lu %8lu %6lu %10llu\n",
+				(unsigned long)stats.size, (unsigned long)stats.live,
+				(unsigned long)stats.chunks, (unsigned long long)stats.allocs);
+		*admin << buffer;
+	}
+
+	// script hooks that are set
+	*admin << CADMIN "Hooks:" CNORMAL "\n";
+	*admin << "  Budget overruns, all scripts: " << Lua::getOverrunCount() << "\n";
+	for (int i = 0; i < Hooks::COUNT; ++i) {
+		if (Hooks::isSet((Hooks::HookID)i)) {
+			snprintf(buffer, sizeof(buffer), "  %-22s %10llu calls %8llums %6llu overruns\n",
+					Hooks::getName((Hooks::HookID)i), (unsigned long long)Hooks::slots[i].calls,
+					(unsigned long long)(Hooks::slots[i].nsecs / 1000000),
+					(unsigned long long)Hooks::slots[i].overruns);
+			*admin << buffer;
+		}
+	}
+}
+
+/* BEGIN COMMAND
+ *
+ * name: admin trace
+ *
+ * format: admin trace dump (80)
+ *
+ * access: ADMIN
+ *
+ * END COMMAND */
+void command_admin_trace(Player* admin, std::string[])
+{
+	std::string path = Trace::dump();
+	if (path.empty())
+		*admin << "Failed to write the trace; see the log.\n";
+	else
+		*admin << "Trace written to " << path << ".\n";
+}
+
+/* BEGIN COMMAND
+ *
+ * name: admin profile
+ *
+ * format: admin profile :0start (80)
+ * format: admin profile :0stop (80)
+ * format: admin profile :0report (80)
+ * format: admin profile :0dump (80)
+ *
+ * access: ADMIN
+ *
+ * END COMMAND */
+void command_admin_profile(Player* admin, std::string argv[])
+{
+	if (argv[0] == "start") {
+		Lua::Profile::start();
+		*admin << "Script profiler started.\n";
+	} else if (argv[0] == "stop") {
+		Lua::Profile::stop();
+		*admin << "Script profiler stopped.\n";
+	} else if (argv[0] == "report") {
+		std::ostringstream report;
+		Lua::Profile::report(report, 20);
+		*admin << report.str();
+	} else if (argv[0] == "dump") {
+		std::string path = Lua::Profile::dump();
+		if (path.empty())
+			*admin << "Failed to write the profile; see the log.\n";
+		else
+			*admin << "Profile written to " << path << ".\n";
+	}
+}
@@ -0,0 +1,194 @@
+/*
+ * Source MUD
+ * Copyright (C) 2000-2005  Sean Middleditch
+ * See the file COPYING for license details
+ * http://www.sourcemud.org
+ */
+
+#include "common.h"
+#include "common/string.h"
+#include "common/streams.h"
+#include "common/time.h"
+#include "common/strbuf.h"
+#include "mud/server.h"
+#include "mud/command.h"
+#include "mud/player.h"
+#include "mud/entity.h"
+#include "mud/room.h"
+#include "mud/object.h"
+#include "mud/macro.h"
+
+namespace {
+	// number of passes to run when none is given
+	const int BENCH_DEFAULT_PASSES = 1000;
+
+	int benchPasses(const std::string& arg)
+	{
+		int passes = arg.empty() ? BENCH_DEFAULT_PASSES : tolong(arg);
+		return passes > 0 ? passes : BENCH_DEFAULT_PASSES;
+	}
+
+	void benchReport(Player* admin, const char* what, uint64 nsecs, size_t count)
+	{
+		char buffer[128];
+		snprintf(buffer, sizeof(buffer), "  %-24s %10.3f ms %8.2f ns/op\n", what,
+				nsecs / 1000000.0, count ? (double)nsecs / count : 0.0);
+		*admin << buffer;
+	}
+}
+
+/* BEGIN COMMAND
+ *
+ * name: admin bench heartbeat
+ * usage: admin bench heartbeat [<passes>]
+ *
+ * format: admin bench heartbeat :0%? (80)
+ *
+ * access: ADMIN
+ *
+ * END COMMAND */
+void command_admin_bench_heartbeat(Player* admin, std::string argv[])
+{
+	int passes = benchPasses(argv[0]);
+
+	// the old registry was a linked list threaded through the
+	// entities in activation order, newest first, with all types
+	// interleaved; rebuild that order in a node list to compare
+	std::list<Entity*> chain;
+	size_t count = 0;
+	for (int type = 0; type < ET_COUNT; ++type) {
+		const EntityList& list = MEntity.getActive((EntityType)type);
+		for (EntityList::const_iterator i = list.begin(); i != list.end(); ++i)
+			chain.push_front(*i);
+		count += list.size();
+	}
+
+	// both walks do the same per-entity work a heartbeat dispatch
+	// does before the entity's own code runs: load and call through
+	// the vtable
+	uint64 start = Time::nsecs();
+	for (int pass = 0; pass < passes; ++pass) {
+		for (int type = 0; type < ET_COUNT; ++type) {
+			const EntityList& list = MEntity.getActive((EntityType)type);
+			for (size_t i = 0; i < list.size(); ++i)
+				list[i]->factoryType();
+		}
+	}
+	uint64 dense = Time::nsecs() - start;
+
+	start = Time::nsecs();
+	for (int pass = 0; pass < passes; ++pass) {
+		for (std::list<Entity*>::const_iterator i = chain.begin(); i != chain.end(); ++i)
+			(*i)->factoryType();
+	}
+	uint64 linked = Time::nsecs() - start;
+
+	*admin << CADMIN "Heartbeat iteration:" CNORMAL " " << count << " entities, " << passes << " passes\n";
+	benchReport(admin, "dense per-type lists", dense, count * passes);
+	benchReport(admin, "linked list", linked, count * passes);
+}
+
+/* BEGIN COMMAND
+ *
+ * name: admin bench casts
+ * usage: admin bench casts [<passes>]
+ *
+ * format: admin bench casts :0%? (80)
+ *
+ * access: ADMIN
+ *
+ * END COMMAND */
+void command_admin_bench_casts(Player* admin, std::string argv[])
+{
+	int passes = benchPasses(argv[0]);
+
+	// every active entity, all types mixed, as the command parser
+	// and the clFind* helpers see them
+	EntityList all;
+	for (int type = 0; type < ET_COUNT; ++type) {
+		const EntityList& list = MEntity.getActive((EntityType)type);
+		all.insert(all.end(), list.begin(), list.end());
+	}
+
+	// the casts _MCommand::call() and the clFind* helpers make on
+	// each entity: PLAYER, CHARACTER, OBJECT and ROOM
+	size_t hits = 0;
+	uint64 start = Time::nsecs();
+	for (int pass = 0; pass < passes; ++pass) {
+		for (size_t i = 0; i < all.size(); ++i) {
+			Entity* entity = all[i];
+			hits += PLAYER(entity) != NULL;
+			hits += CHARACTER(entity) != NULL;
+			hits += OBJECT(entity) != NULL;
+			hits += ROOM(entity) != NULL;
+		}
+	}
+	uint64 tagged = Time::nsecs() - start;
+
+	size_t rtti_hits = 0;
+	start = Time::nsecs();
+	for (int pass = 0; pass < passes; ++pass) {
+		for (size_t i = 0; i < all.size(); ++i) {
+			Entity* entity = all[i];
+			rtti_hits += dynamic_cast<Player*>(entity) != NULL;
+			rtti_hits += dynamic_cast<Creature*>(entity) != NULL;
+			rtti_hits += dynamic_cast<Object*>(entity) != NULL;
+			rtti_hits += dynamic_cast<Room*>(entity) != NULL;
+		}
+	}
+	uint64 rtti = Time::nsecs() - start;
+
+	*admin << CADMIN "Entity casts:" CNORMAL " " << all.size() << " entities, " << passes << " passes";
+	if (hits != rtti_hits)
+		*admin << " (" CWARNING "results differ" CNORMAL ")";
+	*admin << "\n";
+	benchReport(admin, "type tag", tagged, all.size() * passes * 4);
+	benchReport(admin, "dynamic_cast", rtti, all.size() * passes * 4);
+}
+
+/* BEGIN COMMAND
+ *
+ * name: admin bench macro
+ * usage: admin bench macro [<passes>]
+ *
+ * format: admin bench macro :0%? (80)
+ *
+ * access: ADMIN
+ *
+ * END COMMAND */
+void command_admin_bench_macro(Player* admin, std::string argv[])
+{
+	int passes = benchPasses(argv[0]);
+
+	Room* room = admin->getRoom();
+	if (room == NULL) {
+		*admin << "You are not in a room.\n";
+		return;
+	}
+
+	// what a look renders: the room's description, and a line about
+	// a creature in it
+	std::string desc = room->getDesc();
+	std::string line = "  {^$self.He} is {$self.position}.";
+	StringBuffer buffer;
+	StreamControl stream(buffer);
+
+	uint64 start = Time::nsecs();
+	for (int pass = 0; pass < passes; ++pass) {
+		buffer.clear();
+		stream << StreamMacro(desc).set("self", room).set("viewer", admin);
+	}
+	uint64 desc_nsecs = Time::nsecs() - start;
+
+	start = Time::nsecs();
+	for (int pass = 0; pass < passes; ++pass) {
+		buffer.clear();
+		stream << StreamMacro(line).set("self", admin);
+	}
+	uint64 line_nsecs = Time::nsecs() - start;
+
+	*admin << CADMIN "Macro rendering:" CNORMAL " " << passes << " passes\n";
+	benchReport(admin, "room description", desc_nsecs, passes);
+	benchReport(admin, "creature line", line_nsecs, passes);
+	*admin << "  Last output: " << buffer.c_str() << "\n";
+}
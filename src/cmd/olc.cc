@@ -128,6 +128,7 @@ void command_olc_create(Player* builder, std::string argv[])
 
 		*builder << "Room '" << room->getId() << "' added.\n";
 		zone->addRoom(room);
+		room->activate(); // or the next collection frees it
 		// create zone
 	} else if (strEq(argv[0], "zone")) {
 		if (MZone.getZone(argv[1])) {
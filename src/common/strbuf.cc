@@ -29,12 +29,16 @@ void StringBuffer::write(const char* bytes, size_t len)
 	size_t cur_len = strlen(buffer);
 
 	if (cur_len + len + 1 > buffer_size) {
-		char* new_buf = new char[buffer_size + STRING_BUFFER_GROWTH];
+		// grow by at least enough for this write
+		size_t new_size = buffer_size + STRING_BUFFER_GROWTH;
+		if (new_size < cur_len + len + 1)
+			new_size = cur_len + len + 1 + STRING_BUFFER_GROWTH;
+		char* new_buf = new char[new_size];
 		memcpy(new_buf, buffer, cur_len);
 		if (buffer != stat_buffer)
 			delete[] buffer;
 		buffer = new_buf;
-		buffer_size += STRING_BUFFER_GROWTH;
+		buffer_size = new_size;
 	}
 	memcpy(buffer + cur_len, bytes, len);
 	buffer[cur_len + len] = 0;
@@ -212,6 +212,77 @@ bool phraseMatch(const char* match, const char* test)
 	return matches == cchunk ? true : false;
 }
 
+void PhraseTokens::add(const std::string& phrase)
+{
+	const char* c = phrase.c_str();
+	while (*c != '\0') {
+		while (*c != '\0' && isspace(*c))
+			++ c;
+		if (*c == '\0')
+			break;
+
+		Word word;
+		word.start = folded.size();
+		while (*c != '\0' && !isspace(*c))
+			folded.push_back(tolower(*c++));
+		word.length = folded.size() - word.start;
+		words.push_back(word);
+	}
+	phrases.push_back(words.size());
+}
+
+bool PhraseTokens::matches(const char* test) const
+{
+	assert(test != NULL);
+
+	// break up the test string, the same way phraseMatch() does
+	struct chunk {
+		const char *base;
+		uint32 len;
+	} chunks[5];
+	int cchunk = 0;
+
+	const char* c = test;
+	while (cchunk < 5) {
+		while (*c != '\0' && isspace(*c))
+			++ c;
+		if (*c == '\0')
+			break;
+		chunks[cchunk].base = c;
+		while (*c != '\0' && !isspace(*c))
+			++ c;
+		chunks[cchunk].len = c - chunks[cchunk].base;
+		++ cchunk;
+	}
+	if (cchunk == 0)
+		return false;
+
+	// each chunk must be a prefix of a word, in order
+	uint32 first = 0;
+	for (std::vector<uint32>::const_iterator p = phrases.begin(); p != phrases.end(); first = *p++) {
+		int matches = 0;
+		for (uint32 w = first; w != *p; ++w) {
+			const chunk& ck = chunks[matches];
+			if (ck.len > words[w].length)
+				continue;
+			const char* word = folded.data() + words[w].start;
+			uint32 i = 0;
+			while (i != ck.len && tolower(ck.base[i]) == word[i])
+				++ i;
+			if (i == ck.len && ++ matches == cchunk)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+void PhraseTokens::getWords(std::vector<std::string>& out) const
+{
+	for (std::vector<Word>::const_iterator i = words.begin(); i != words.end(); ++i)
+		out.push_back(folded.substr(i->start, i->length));
+}
+
 std::string getNumSuffix(unsigned int num)
 {
 	if (num == 11 || num == 12 || num == 13) { return "th"; }
@@ -323,6 +394,21 @@ std::string strlower(const std::string& str)
 	return rs;
 }
 
+std::vector<std::string>& explodeWords(std::vector<std::string>& list, const std::string& str)
+{
+	const char* c = str.c_str();
+	while (*c != '\0') {
+		while (*c != '\0' && isspace(*c))
+			++c;
+		const char* word = c;
+		while (*c != '\0' && !isspace(*c))
+			++c;
+		if (c != word)
+			list.push_back(strlower(std::string(word, c - word)));
+	}
+	return list;
+}
+
 namespace
 {
 	struct Replace {
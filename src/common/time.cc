@@ -34,3 +34,16 @@ std::string Time::format(const std::string& format, time_t time)
 	strftime(buf, sizeof(buf), format.c_str(), localtime(&time));
 	return buf;
 }
+
+uint64 Time::nsecs()
+{
+#ifdef HAVE_CLOCK_GETTIME
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (uint64)tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000ULL;
+#endif
+}
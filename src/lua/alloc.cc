@@ -0,0 +1,249 @@
+/*
+ * Source MUD
+ * Copyright (C) 2000-2005  Sean Middleditch
+ * See the file COPYING for license details
+ * http://www.sourcemud.org
+ */
+
+#include "common.h"
+#include "lua/alloc.h"
+
+namespace Lua
+{
+	namespace Alloc
+	{
+		int enforce = 0;
+	}
+}
+
+namespace {
+	using Lua::Alloc::ClassStats;
+	using Lua::Alloc::MAX_SMALL;
+
+	const size_t CHUNK_SIZE = 16 * 1024;
+
+	// block sizes; all multiples of 16, so blocks stay aligned
+	const size_t class_sizes[] = { 16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256 };
+	const size_t CLASS_COUNT = sizeof(class_sizes) / sizeof(class_sizes[0]);
+
+	struct FreeBlock {
+		FreeBlock* next;
+	};
+
+	struct SizeClass {
+		FreeBlock* free;
+		char* carve; // unused tail of the newest chunk
+		char* carve_end;
+		ClassStats stats;
+	};
+
+	SizeClass classes[CLASS_COUNT];
+
+	// size class for each request size in 16 byte steps
+	unsigned char class_index[MAX_SMALL / 16 + 1];
+
+	size_t bytes = 0;
+	size_t peak = 0;
+	size_t reserved = 0;
+	size_t limit = 0;
+	uint64 allocs = 0;
+	uint64 frees = 0;
+	uint64 denied = 0;
+
+	bool setup()
+	{
+		size_t c = 0;
+		for (size_t i = 0; i <= MAX_SMALL / 16; ++i) {
+			while (class_sizes[c] < i * 16)
+				++c;
+			class_index[i] = c;
+		}
+		for (size_t i = 0; i < CLASS_COUNT; ++i) {
+			classes[i].free = NULL;
+			classes[i].carve = classes[i].carve_end = NULL;
+			classes[i].stats.size = class_sizes[i];
+			classes[i].stats.live = 0;
+			classes[i].stats.chunks = 0;
+			classes[i].stats.allocs = 0;
+		}
+		return true;
+	}
+	bool ready = setup();
+
+	inline SizeClass& classFor(size_t size)
+	{
+		return classes[class_index[(size + 15) / 16]];
+	}
+
+	void* allocSmall(SizeClass& sc)
+	{
+		++sc.stats.live;
+		++sc.stats.allocs;
+
+		if (sc.free != NULL) {
+			FreeBlock* block = sc.free;
+			sc.free = block->next;
+			return block;
+		}
+
+		if (sc.carve == sc.carve_end) {
+			char* chunk = (char*)malloc(CHUNK_SIZE);
+			if (chunk == NULL) {
+				--sc.stats.live;
+				--sc.stats.allocs;
+				return NULL;
+			}
+			sc.carve = chunk;
+			sc.carve_end = chunk + CHUNK_SIZE - CHUNK_SIZE % sc.stats.size;
+			++sc.stats.chunks;
+			reserved += CHUNK_SIZE;
+		}
+
+		void* block = sc.carve;
+		sc.carve += sc.stats.size;
+		return block;
+	}
+
+	inline void freeSmall(SizeClass& sc, void* ptr)
+	{
+		FreeBlock* block = (FreeBlock*)ptr;
+		block->next = sc.free;
+		sc.free = block;
+		--sc.stats.live;
+	}
+}
+
+void* Lua::Alloc::alloc(void*, void* ptr, size_t osize, size_t nsize)
+{
+	// free
+	if (nsize == 0) {
+		if (ptr == NULL)
+			return NULL;
+		if (osize <= MAX_SMALL) {
+			freeSmall(classFor(osize), ptr);
+		} else {
+			free(ptr);
+			reserved -= osize;
+		}
+		bytes -= osize;
+		++frees;
+		return NULL;
+	}
+
+	// growing past the cap fails; shrinking never may
+	if (limit != 0 && enforce != 0 && nsize > osize && bytes - osize + nsize > limit) {
+		++denied;
+		return NULL;
+	}
+
+	void* block;
+	if (osize <= MAX_SMALL && nsize <= MAX_SMALL) {
+		// same class, nothing to do
+		if (ptr != NULL && &classFor(osize) == &classFor(nsize)) {
+			bytes += nsize - osize;
+			return ptr;
+		}
+
+		block = allocSmall(classFor(nsize));
+		if (block == NULL) {
+			// shrinking must not fail: the old block moves to the
+			// smaller class as it is, being big enough for it
+			if (ptr == NULL || nsize > osize)
+				return NULL;
+			--classFor(osize).stats.live;
+			++classFor(nsize).stats.live;
+			block = ptr;
+		} else if (ptr != NULL) {
+			memcpy(block, ptr, osize < nsize ? osize : nsize);
+			freeSmall(classFor(osize), ptr);
+		}
+	} else if (osize > MAX_SMALL && nsize > MAX_SMALL) {
+		// large to large is plain realloc
+		block = realloc(ptr, nsize);
+		if (block == NULL) {
+			if (nsize > osize)
+				return NULL;
+			block = ptr;
+		}
+		reserved += nsize - osize;
+	} else if (nsize > MAX_SMALL) {
+		// small (or new) to large
+		block = malloc(nsize);
+		if (block == NULL)
+			return NULL;
+		reserved += nsize;
+		if (ptr != NULL) {
+			memcpy(block, ptr, osize);
+			freeSmall(classFor(osize), ptr);
+		}
+	} else {
+		// large to small; if that fails the old block joins the
+		// small class as it is, and stays in its pool once freed
+		block = allocSmall(classFor(nsize));
+		if (block == NULL) {
+			++classFor(nsize).stats.live;
+			block = ptr;
+		} else {
+			memcpy(block, ptr, nsize);
+			free(ptr);
+			reserved -= osize;
+		}
+	}
+
+	if (ptr == NULL)
+		++allocs;
+	bytes += nsize - osize;
+	if (bytes > peak)
+		peak = bytes;
+	return block;
+}
+
+void Lua::Alloc::setLimit(size_t s_limit)
+{
+	limit = s_limit;
+}
+
+size_t Lua::Alloc::getLimit()
+{
+	return limit;
+}
+
+size_t Lua::Alloc::getBytes()
+{
+	return bytes;
+}
+
+size_t Lua::Alloc::getPeak()
+{
+	return peak;
+}
+
+size_t Lua::Alloc::getReserved()
+{
+	return reserved;
+}
+
+uint64 Lua::Alloc::getAllocs()
+{
+	return allocs;
+}
+
+uint64 Lua::Alloc::getFrees()
+{
+	return frees;
+}
+
+uint64 Lua::Alloc::getDenied()
+{
+	return denied;
+}
+
+size_t Lua::Alloc::getClassCount()
+{
+	return CLASS_COUNT;
+}
+
+const ClassStats& Lua::Alloc::getClass(size_t index)
+{
+	return classes[index].stats;
+}
@@ -0,0 +1,146 @@
+/*
+ * Source MUD
+ * Copyright (C) 2000-2005  Sean Middleditch
+ * See the file COPYING for license details
+ * http://www.sourcemud.org
+ */
+
+#include "common.h"
+#include "common/log.h"
+#include "common/md5.h"
+#include "common/file.h"
+#include "mud/settings.h"
+#include "lua/core.h"
+#include "lua/bytecode.h"
+#include "lib/lua51/lua.h"
+#include "lib/lua51/lauxlib.h"
+
+namespace {
+	uint64 hits = 0;
+	uint64 misses = 0;
+	bool dir_checked = false;
+
+	// cache file for a key; empty if the cache is off.  the key's
+	// length guards against the unpadded hash running two words
+	// together the same way for different keys
+	std::string pathFor(const std::string& key)
+	{
+		const std::string& dir = MSettings.getLuaCachePath();
+		if (dir.empty())
+			return std::string();
+
+		std::ostringstream path;
+		path << dir << "/" << MD5::hash(key) << "-" << key.size() << ".luac";
+		return path.str();
+	}
+
+	bool readAll(const std::string& path, std::string& out)
+	{
+		FILE* file = fopen(path.c_str(), "rb");
+		if (file == NULL)
+			return false;
+
+		char buffer[8192];
+		size_t len;
+		out.clear();
+		while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0)
+			out.append(buffer, len);
+
+		bool ok = !ferror(file);
+		fclose(file);
+		return ok;
+	}
+
+	int writer(lua_State*, const void* p, size_t size, void* ud)
+	{
+		((std::string*)ud)->append((const char*)p, size);
+		return 0;
+	}
+}
+
+bool Lua::Bytecode::load(const std::string& key)
+{
+	std::string path = pathFor(key);
+	std::string code;
+	if (path.empty() || !readAll(path, code)) {
+		++misses;
+		return false;
+	}
+
+	// only accept precompiled chunks, never source
+	bool binary = code.compare(0, strlen(LUA_SIGNATURE), LUA_SIGNATURE) == 0;
+	if (!binary || luaL_loadbuffer(Lua::state, code.data(), code.size(), "=cache") != 0) {
+		if (binary)
+			lua_pop(Lua::state, 1);
+		Log::Warning << "Ignoring bad bytecode cache entry " << path;
+		++misses;
+		return false;
+	}
+
+	++hits;
+	return true;
+}
+
+void Lua::Bytecode::store(const std::string& key)
+{
+	std::string path = pathFor(key);
+	if (path.empty())
+		return;
+
+	// create the directory the first time
+	if (!dir_checked) {
+		dir_checked = true;
+		if (mkdir(MSettings.getLuaCachePath().c_str(), 0755) != 0 && errno != EEXIST)
+			Log::Warning << "Failed to create " << MSettings.getLuaCachePath() << ": " << strerror(errno);
+	}
+
+	std::string code;
+	if (lua_dump(Lua::state, writer, &code) != 0)
+		return;
+
+	// write and rename, so a reader never sees half a chunk
+	std::string tmp = path + ".tmp";
+	FILE* file = fopen(tmp.c_str(), "wb");
+	if (file == NULL)
+		return;
+	bool ok = fwrite(code.data(), 1, code.size(), file) == code.size();
+	if (fclose(file) != 0)
+		ok = false;
+	if (!ok || !File::rename(tmp, path))
+		File::remove(tmp);
+}
+
+int Lua::Bytecode::loadFile(const std::string& path)
+{
+	std::string source;
+	if (!readAll(path, source)) {
+		lua_pushfstring(Lua::state, "cannot read %s: %s", path.c_str(), strerror(errno));
+		return LUA_ERRFILE;
+	}
+
+	// like luaL_loadfile(), skip a #! line but keep the line count
+	if (!source.empty() && source[0] == '#') {
+		size_t end = source.find('\n');
+		source.erase(0, end == std::string::npos ? source.size() : end);
+	}
+
+	std::string key = "file\n" + path + "\n" + source;
+	if (load(key))
+		return 0;
+
+	std::string chunkname = "@" + path;
+	int rs = luaL_loadbuffer(Lua::state, source.data(), source.size(), chunkname.c_str());
+	if (rs == 0)
+		store(key);
+	return rs;
+}
+
+uint64 Lua::Bytecode::getHits()
+{
+	return hits;
+}
+
+uint64 Lua::Bytecode::getMisses()
+{
+	return misses;
+}
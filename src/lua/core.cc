@@ -7,7 +7,13 @@
 
 #include "common.h"
 #include "common/log.h"
+#include "common/time.h"
+#include "mud/settings.h"
+#include "mud/trace.h"
 #include "lua/core.h"
+#include "lua/alloc.h"
+#include "lua/bytecode.h"
+#include "lua/profile.h"
 #include "lib/lua51/lua.h"
 #include "lib/lua51/lauxlib.h"
 #include "lib/lua51/lualib.h"
@@ -20,6 +26,136 @@ namespace Lua
 	extern bool initializeMisclib();
 	extern bool initializeMudlib();
 	extern bool initializeEntlib();
+	extern bool initializeMacrolib();
+
+	namespace {
+		// how often the budget hook runs, in VM instructions
+		const int BUDGET_STEP = 1000;
+
+		// budget of the innermost pcall() in progress
+		struct Budget {
+			uint64 limit; // instructions; 0 if unlimited
+			uint64 used; // instructions, counted in BUDGET_STEPs
+			uint64 deadline; // Time::nsecs(); 0 if unlimited
+			bool overran;
+		} budget = { 0, 0, 0, false };
+
+		uint64 overruns = 0;
+
+		// idle collection; a new cycle is only started once the heap
+		// has grown by half since the last one finished
+		const int GC_STEP = 8;
+		struct IdleGC {
+			uint64 nsecs;
+			uint64 steps;
+			uint64 cycles;
+			size_t cycle_kb; // heap size at the end of the last cycle
+			bool in_cycle;
+		} gc = { 0, 0, 0, 0, false };
+
+		// also the profiler's sampling hook, while it runs
+		void budgetHook(lua_State* s, lua_Debug*)
+		{
+			if (!budget.overran) {
+				if (Profile::running)
+					Profile::sample(s);
+
+				budget.used += BUDGET_STEP;
+				if ((budget.limit == 0 || budget.used < budget.limit) &&
+						(budget.deadline == 0 || Time::nsecs() < budget.deadline))
+					return;
+
+				// the budget stays spent until the pcall() that set it
+				// returns, and the error is raised again on every
+				// instruction, so a script can't pcall() its way past it
+				budget.overran = true;
+				lua_sethook(s, budgetHook, LUA_MASKCOUNT, 1);
+			}
+
+			// blame the running function
+			lua_Debug ar;
+			if (lua_getstack(s, 0, &ar) && lua_getinfo(s, "Sl", &ar))
+				lua_pushfstring(s, "%s:%d: script exceeded its budget", ar.short_src, ar.currentline);
+			else
+				lua_pushstring(s, "script exceeded its budget");
+			lua_error(s);
+		}
+
+		// begin a call's budget, returning the outer one to restore;
+		// a nested call gets no more than the outer call has left
+		Budget startBudget(uint64 max_instructions, uint64 max_nsecs)
+		{
+			Budget outer = budget;
+
+			budget.limit = max_instructions;
+			if (outer.limit != 0) {
+				uint64 left = outer.used < outer.limit ? outer.limit - outer.used : 1;
+				if (budget.limit == 0 || left < budget.limit)
+					budget.limit = left;
+			}
+			budget.used = 0;
+
+			budget.deadline = max_nsecs ? Time::nsecs() + max_nsecs : 0;
+			if (outer.deadline != 0 && (budget.deadline == 0 || outer.deadline < budget.deadline))
+				budget.deadline = outer.deadline;
+
+			budget.overran = outer.overran;
+			return outer;
+		}
+
+		// restore the outer budget, charging it for what the call used
+		void finishBudget(const Budget& outer, bool* overran)
+		{
+			// an overrun inherited from the outer call is its own
+			bool ours = budget.overran && !outer.overran;
+			if (ours)
+				++overruns;
+			if (overran != NULL)
+				*overran = ours;
+
+			uint64 used = budget.used;
+			budget = outer;
+			budget.used += used;
+			if ((budget.limit != 0 && budget.used >= budget.limit) ||
+					(budget.deadline != 0 && Time::nsecs() >= budget.deadline))
+				budget.overran = true;
+		}
+
+		// an error outside any pcall; Lua exits after this returns
+		int panic(lua_State* s)
+		{
+			Log::Error << "Lua panic: " << lua_tostring(s, -1);
+			return 0;
+		}
+
+		// dofile() that goes through the bytecode cache
+		int dofile(lua_State* s)
+		{
+			const char* path = luaL_checkstring(s, 1);
+			int top = lua_gettop(s);
+
+			int rs = Bytecode::loadFile(path);
+			if (s != state)
+				lua_xmove(state, s, 1);
+			if (rs != 0)
+				return lua_error(s);
+
+			lua_call(s, 0, LUA_MULTRET);
+			return lua_gettop(s) - top;
+		}
+
+		// install or clear the hook on s to match the current budget
+		// and the profiler
+		void setBudgetHook(lua_State* s)
+		{
+			if (budget.overran)
+				lua_sethook(s, budgetHook, LUA_MASKCOUNT, 1);
+			else if (Profile::running || budget.limit != 0 || budget.deadline != 0)
+				lua_sethook(s, budgetHook, LUA_MASKCOUNT, BUDGET_STEP);
+			else
+				lua_sethook(s, NULL, 0, 0);
+		}
+	}
 }
 
 bool Lua::initialize()
@@ -30,14 +166,22 @@ bool Lua::initialize()
 
 	Log::Info << "Initializing Lua...";
 
-	// initialize the Lua state object
-	if ((Lua::state = luaL_newstate()) == NULL) {
-		Log::Error << "luaL_newstate() failed";
+	// initialize the Lua state object, with our allocator
+	Alloc::setLimit((size_t)MSettings.getLuaMemory() * 1024 * 1024);
+	if ((Lua::state = lua_newstate(Alloc::alloc, NULL)) == NULL) {
+		Log::Error << "lua_newstate() failed";
 		return false;
 	}
+	lua_atpanic(state, panic);
+
+	// a lazier collector than Lua's default; collectIdle() does the
+	// steady-state work, this is the backstop
+	lua_gc(state, LUA_GCSETPAUSE, MSettings.getLuaGcPause());
+	lua_gc(state, LUA_GCSETSTEPMUL, MSettings.getLuaGcStepmul());
 
 	// load Lua libs
 	luaL_openlibs(state);
+	lua_register(state, "dofile", dofile);
 
 	// set some special variables
 	lua_pushstring(state, PACKAGE_VERSION);
@@ -55,6 +199,8 @@ bool Lua::initialize()
 		return false;
 	if (!initializeEntlib())
 		return false;
+	if (!initializeMacrolib())
+		return false;
 
 	return true;
 }
@@ -67,6 +213,100 @@ void Lua::shutdown()
 	}
 }
 
+int Lua::pcall(int nargs, int nresults, uint64 max_instructions, uint64 max_nsecs, bool* overran)
+{
+	// save the budget of any call we're nested in
+	Budget outer = startBudget(max_instructions, max_nsecs);
+	setBudgetHook(state);
+
+	const char* old_root = Profile::enter(NULL);
+	++Alloc::enforce;
+	int rs = lua_pcall(state, nargs, nresults, 0);
+	--Alloc::enforce;
+	Profile::leave(old_root);
+
+	// restore the outer budget
+	finishBudget(outer, overran);
+	setBudgetHook(state);
+
+	return rs;
+}
+
+int Lua::pcall(int nargs, int nresults, bool* overran)
+{
+	return pcall(nargs, nresults, (uint64)MSettings.getLuaInstructions(),
+			(uint64)MSettings.getLuaTime() * 1000000, overran);
+}
+
+int Lua::resume(lua_State* thread, int nargs, bool* overran)
+{
+	// the hook is per thread, so only the thread needs it; the
+	// caller's thread picks the outer budget back up on its next tick
+	Budget outer = startBudget((uint64)MSettings.getLuaInstructions(), (uint64)MSettings.getLuaTime() * 1000000);
+	setBudgetHook(thread);
+
+	const char* old_root = Profile::enter("thread");
+	++Alloc::enforce;
+	int rs = lua_resume(thread, nargs);
+	--Alloc::enforce;
+	Profile::leave(old_root);
+
+	lua_sethook(thread, NULL, 0, 0);
+	finishBudget(outer, overran);
+
+	return rs;
+}
+
+uint64 Lua::collectIdle(uint64 max_nsecs)
+{
+	if (state == NULL || max_nsecs == 0)
+		return 0;
+
+	// not enough garbage yet to be worth a cycle
+	size_t kb = lua_gc(state, LUA_GCCOUNT, 0);
+	if (!gc.in_cycle && kb < gc.cycle_kb + gc.cycle_kb / 2)
+		return 0;
+
+	uint64 start = Time::nsecs();
+	uint64 now;
+	do {
+		++gc.steps;
+		if (lua_gc(state, LUA_GCSTEP, GC_STEP)) {
+			gc.in_cycle = false;
+			gc.cycle_kb = lua_gc(state, LUA_GCCOUNT, 0);
+			++gc.cycles;
+			now = Time::nsecs();
+			break;
+		}
+		gc.in_cycle = true;
+		now = Time::nsecs();
+	} while (now - start < max_nsecs);
+
+	gc.nsecs += now - start;
+	Trace::record(Trace::GC, 0, (now - start) / 1000);
+	return now - start;
+}
+
+uint64 Lua::getIdleGCTime()
+{
+	return gc.nsecs;
+}
+
+uint64 Lua::getIdleGCSteps()
+{
+	return gc.steps;
+}
+
+uint64 Lua::getIdleGCCycles()
+{
+	return gc.cycles;
+}
+
+uint64 Lua::getOverrunCount()
+{
+	return overruns;
+}
+
 bool Lua::runfile(const std::string& path)
 {
 	if (!state) {
@@ -75,7 +315,7 @@ bool Lua::runfile(const std::string& path)
 	}
 
 	// load the script
-	int rs = luaL_loadfile(state, path.c_str());
+	int rs = Bytecode::loadFile(path);
 	if (rs != 0) {
 		Log::Error << "Couldn't load script: " << lua_tostring(state, -1);
 		lua_pop(state, 1);
@@ -6,13 +6,26 @@
  */
 
 #include "common.h"
+#include "common/string.h"
 #include "mud/entity.h"
+#include "mud/room.h"
+#include "mud/creature.h"
 #include "lua/core.h"
 #include "lib/lua51/lua.h"
 #include "lib/lua51/lauxlib.h"
 #include "lib/lua51/lualib.h"
 
-#define CHECKSELF(n) n* self = (n*)luaL_checkudata(s, 1, #n)
+// entity userdata holds an EntityHandle; error out if the
+// entity has been freed since
+#define CHECKSELF(n) \
+	n* self = (n*)((EntityHandle*)luaL_checkudata(s, 1, "Entity"))->get(); \
+	if (self == NULL) \
+		return luaL_error(s, "entity no longer exists")
+
+namespace {
+	// stats() keys, the lower-cased stat names
+	std::string stat_keys[CreatureStatID::COUNT];
+}
 
 // -------------------
 //   BINDINGS
@@ -26,8 +39,12 @@ namespace bindings {
 namespace entity {
 
 int getName(lua_State*);
+int creatures(lua_State*);
+int stats(lua_State*);
 const luaL_Reg methods[] = {
 	{ "getName", getName },
+	{ "creatures", creatures },
+	{ "stats", stats },
 	{ NULL, NULL }
 };
 
@@ -39,8 +56,65 @@ int getName(lua_State* s)
 {
 	CHECKSELF(Entity);
 
-	// push the name, return
-	lua_pushstring(s, self->getName().getFull().c_str());
+	// push the name, return; it goes onto the main stack, so move it
+	// over when called from a mud.spawn thread
+	self->pushLuaName();
+	if (s != Lua::state)
+		lua_xmove(Lua::state, s, 1);
+	return 1;
+}
+
+/**
+ * name: Entity:creatures
+ * return: table of the creatures in the room
+ *
+ * Rooms only.
+ */
+int creatures(lua_State* s)
+{
+	CHECKSELF(Entity);
+	Room* room = ROOM(self);
+	if (room == NULL)
+		return luaL_error(s, "entity is not a room");
+
+	lua_createtable(s, room->creatures.size(), 0);
+	int n = 0;
+	for (IndexedEList<Creature>::const_iterator i = room->creatures.begin(); i != room->creatures.end(); ++i) {
+		(*i)->pushLuaTable();
+		if (s != Lua::state)
+			lua_xmove(Lua::state, s, 1);
+		lua_rawseti(s, -2, ++n);
+	}
+	return 1;
+}
+
+/**
+ * name: Entity:stats
+ * return: table with hp, max_hp, dead, position and the effective
+ *         value of each stat, keyed by its lower-cased name
+ *
+ * Creatures only.
+ */
+int stats(lua_State* s)
+{
+	CHECKSELF(Entity);
+	Creature* creature = CHARACTER(self);
+	if (creature == NULL)
+		return luaL_error(s, "entity is not a creature");
+
+	lua_createtable(s, 0, CreatureStatID::COUNT + 4);
+	lua_pushinteger(s, creature->getHP());
+	lua_setfield(s, -2, "hp");
+	lua_pushinteger(s, creature->getMaxHP());
+	lua_setfield(s, -2, "max_hp");
+	lua_pushboolean(s, creature->isDead());
+	lua_setfield(s, -2, "dead");
+	lua_pushstring(s, creature->getPosition().getName().c_str());
+	lua_setfield(s, -2, "position");
+	for (int i = 0; i < CreatureStatID::COUNT; ++i) {
+		lua_pushinteger(s, creature->getEffectiveStat(i));
+		lua_setfield(s, -2, stat_keys[i].c_str());
+	}
 	return 1;
 }
 
@@ -56,9 +130,16 @@ int getName(lua_State* s)
 namespace Lua {
 	bool initializeEntlib()
 	{
+		for (int i = 0; i < CreatureStatID::COUNT; ++i)
+			stat_keys[i] = strlower(CreatureStatID(i).getName());
+
 		// create the Entity metatable
 		luaL_newmetatable(Lua::state, "Entity");
 		luaL_register(Lua::state, NULL, bindings::entity::methods);
+
+		// methods are looked up in the metatable itself
+		lua_pushvalue(Lua::state, -1);
+		lua_setfield(Lua::state, -2, "__index");
 		lua_pop(Lua::state, 1);
 
 		return true;
@@ -7,14 +7,18 @@
 
 #include "common.h"
 #include "common/log.h"
+#include "common/time.h"
 #include "lua/core.h"
 #include "lua/exec.h"
 #include "lua/print.h"
+#include "lua/profile.h"
+#include "mud/trace.h"
+#include "mud/entity.h"
 #include "lib/lua51/lua.h"
 #include "lib/lua51/lauxlib.h"
 #include "lib/lua51/lualib.h"
 
-Lua::Exec::Exec(const std::string& funcname) : stack(0), print(NULL)
+Lua::Exec::Exec(const std::string& funcname) : stack(0), print(NULL), max_instructions(0), max_nsecs(0), has_budget(false), hook(Hooks::COUNT)
 {
 	// look up the function
 	lua_getglobal(Lua::state, funcname.c_str());
@@ -48,6 +52,17 @@ void Lua::Exec::param(const char* str, size_t len)
 	}
 }
 
+void Lua::Exec::param(Entity* entity)
+{
+	if (stack != 0) {
+		if (entity != NULL)
+			entity->pushLuaTable();
+		else
+			lua_pushnil(Lua::state);
+		++stack;
+	}
+}
+
 void Lua::Exec::param(void *object) {
 	if (stack != 0) {
 		Lua::getObject(object);
@@ -112,9 +127,22 @@ bool Lua::Exec::run()
 	// set the print handler
 	Lua::setPrint(print);
 
-	// execute the function
-	if (lua_pcall(Lua::state, stack - 1, 1, 0) != 0) {
-		Log::Info << "post-run " << lua_gettop(Lua::state) << " " << stack;
+	// execute the function; hooks are timed, and head their stacks
+	// in profiles
+	bool overran = false;
+	uint64 start = hook != Hooks::COUNT ? Time::nsecs() : 0;
+	const char* old_root = Lua::Profile::enter(hook != Hooks::COUNT ? Hooks::getName(hook) : NULL);
+	int rs = has_budget ?
+			Lua::pcall(stack - 1, 1, max_instructions, max_nsecs, &overran) :
+			Lua::pcall(stack - 1, 1, &overran);
+	Lua::Profile::leave(old_root);
+	if (hook != Hooks::COUNT) {
+		Hooks::slots[hook].nsecs += Time::nsecs() - start;
+		if (overran)
+			++Hooks::slots[hook].overruns;
+	}
+	if (rs != 0) {
+		Log::Error << "Lua: " << lua_tostring(Lua::state, -1);
 		// remove the error
 		lua_pop(Lua::state, 1);
 		// we have nothing left on the stack
@@ -131,25 +159,30 @@ bool Lua::Exec::run()
 	}
 }
 
-Lua::ExecHook::ExecHook(const std::string& hookname) : Lua::Exec()
-{
-	// look up hook table
-	lua_getfield(Lua::state, LUA_REGISTRYINDEX, "_hooks");
-	if (!lua_isnil(Lua::state, -1)) {
-		// get the hook from the table
-		lua_getfield(Lua::state, -1, hookname.c_str());
-		if (!lua_isnil(Lua::state, -1)) {
-			// remove hook table
-			lua_remove(Lua::state, -2);
-			stack = 1;
-		} else {
-			// clean up table and nil
-			lua_pop(Lua::state, 2);
-		}
-	} else {
-		// clean up table
+Lua::ExecHook::ExecHook(Hooks::HookID id) : Lua::Exec()
+{
+	Hooks::Slot& slot = Hooks::slots[id];
+	if (slot.ref == 0)
+		return;
+
+	lua_rawgeti(Lua::state, LUA_REGISTRYINDEX, slot.ref);
+	stack = 1;
+
+	if (slot.has_budget)
+		setBudget(slot.max_instructions, slot.max_nsecs);
+	hook = id;
+
+	++slot.calls;
+	Trace::record(Trace::HOOK, slot.trace_name);
+}
+
+Lua::ExecRef::ExecRef(int ref) : Lua::Exec()
+{
+	lua_rawgeti(Lua::state, LUA_REGISTRYINDEX, ref);
+	if (lua_isfunction(Lua::state, -1))
+		stack = 1;
+	else
 		lua_pop(Lua::state, 1);
-	}
 }
 
 void Lua::Exec::cleanup()
@@ -8,6 +8,10 @@
 #include "common.h"
 #include "common/log.h"
 #include "mud/settings.h"
+#include "mud/hooks.h"
+#include "mud/clock.h"
+#include "mud/entity.h"
+#include "mud/scheduler.h"
 #include "lua/core.h"
 #include "lib/lua51/lua.h"
 #include "lib/lua51/lauxlib.h"
@@ -28,11 +32,19 @@ int setHook(lua_State*);
 int getConfigInt(lua_State*);
 int getConfigBool(lua_State*);
 int getConfigString(lua_State*);
+int spawn(lua_State*);
+int sleep(lua_State*);
+int waitEvent(lua_State*);
+int tagged(lua_State*);
 const luaL_Reg registry[] = {
 	{ "setHook", setHook },
 	{ "getConfigInt", getConfigInt },
 	{ "getConfigBool", getConfigBool },
 	{ "getConfigString", getConfigString },
+	{ "spawn", spawn },
+	{ "sleep", sleep },
+	{ "waitEvent", waitEvent },
+	{ "tagged", tagged },
 	{ NULL, NULL }
 };
 
@@ -40,26 +52,44 @@ const luaL_Reg registry[] = {
  * name: mud.setHook
  * param: string name
  * param: function callback
+ * param: table budget (optional; fields instructions and time, in
+ *        milliseconds, override the lua_instructions and lua_time
+ *        settings for this hook; 0 is no limit, and a missing field
+ *        keeps the setting)
  */
 int setHook(lua_State* s)
 {
 	luaL_checkstring(s, 1);
 	luaL_checktype(s, 2, LUA_TFUNCTION);
 
-	// fetch our hook registry, or create it if it doesn't exist
-	lua_getfield(s, LUA_REGISTRYINDEX, "_hooks");
-	if (lua_isnil(s, -1)) {
-		lua_newtable(s);
-		lua_pushvalue(s, -1);
-		lua_setfield(s, LUA_REGISTRYINDEX, "_hooks");
+	// resolve the name now, so calling the hook is just an array
+	// lookup
+	Hooks::HookID id = Hooks::lookup(lua_tostring(s, 1));
+	if (id == Hooks::COUNT) {
+		Log::Warning << "mud.setHook: unknown hook '" << lua_tostring(s, 1) << "'";
+		lua_pushboolean(s, false);
+		return 1;
 	}
 
-	// rearrange fields (ugh)
-	lua_pushvalue(s, 1);
-	lua_pushvalue(s, 2);
+	// optional budget; 0 is no limit
+	bool has_budget = !lua_isnoneornil(s, 3);
+	uint64 max_instructions = 0, max_nsecs = 0;
+	if (has_budget) {
+		luaL_checktype(s, 3, LUA_TTABLE);
+		lua_getfield(s, 3, "instructions");
+		lua_getfield(s, 3, "time");
+		lua_Number instructions = lua_isnil(s, -2) ? (lua_Number)MSettings.getLuaInstructions() : lua_tonumber(s, -2);
+		lua_Number msecs = lua_isnil(s, -1) ? (lua_Number)MSettings.getLuaTime() : lua_tonumber(s, -1);
+		if (instructions < 0 || msecs < 0)
+			return luaL_argerror(s, 3, "budget must not be negative");
+		max_instructions = (uint64)instructions;
+		max_nsecs = (uint64)msecs * 1000000;
+		lua_pop(s, 2);
+	}
 
 	// set the hook
-	lua_settable(s, -3);
+	lua_pushvalue(s, 2);
+	Hooks::set(id, has_budget, max_instructions, max_nsecs);
 
 	// return true value
 	lua_pushboolean(s, true);
@@ -102,6 +132,126 @@ int getConfigString(lua_State* s)
 	return 1;
 }
 
+/**
+ * name: mud.spawn
+ * param: Entity owner (or nil)
+ * param: function callback
+ * param: ... arguments to the callback
+ *
+ * Runs the callback as a thread that may call mud.sleep and
+ * mud.waitEvent.  It runs right away until it first waits.  If
+ * owner is given, the thread is killed when owner is destroyed.
+ */
+int spawn(lua_State* s)
+{
+	Entity* owner = NULL;
+	if (!lua_isnil(s, 1)) {
+		owner = ((EntityHandle*)luaL_checkudata(s, 1, "Entity"))->get();
+		if (owner == NULL)
+			return luaL_error(s, "entity no longer exists");
+	}
+	luaL_checktype(s, 2, LUA_TFUNCTION);
+
+	MScheduler.spawn(s, lua_gettop(s) - 2, owner);
+	return 0;
+}
+
+/**
+ * name: mud.sleep
+ * param: number rounds
+ *
+ * Only from a thread started with mud.spawn.
+ */
+int sleep(lua_State* s)
+{
+	lua_Number rounds = luaL_checknumber(s, 1);
+	if (rounds < 0)
+		rounds = 0;
+
+	uint32 ticks = (uint32)ceil(rounds * TICKS_PER_ROUND);
+	if (!MScheduler.sleep(s, ticks))
+		return luaL_error(s, "mud.sleep called outside of mud.spawn");
+	return lua_yield(s, 0);
+}
+
+/**
+ * name: mud.waitEvent
+ * param: Entity entity
+ * param: string event (or a table of event names)
+ * param: number timeout in rounds (optional)
+ * return: string event name, then the event's aux entities; nothing
+ *         if the wait timed out or the entity was destroyed
+ *
+ * Only from a thread started with mud.spawn.
+ */
+int waitEvent(lua_State* s)
+{
+	Entity* entity = ((EntityHandle*)luaL_checkudata(s, 1, "Entity"))->get();
+	if (entity == NULL)
+		return luaL_error(s, "entity no longer exists");
+
+	// one event name or a list of them
+	EventMask events = 0;
+	if (lua_istable(s, 2)) {
+		for (int i = 1; ; ++i) {
+			lua_rawgeti(s, 2, i);
+			if (lua_isnil(s, -1)) {
+				lua_pop(s, 1);
+				break;
+			}
+			EventID id = EventID::lookup(luaL_checkstring(s, -1));
+			if (!id.valid())
+				return luaL_error(s, "unknown event '%s'", lua_tostring(s, -1));
+			events |= id.getMask();
+			lua_pop(s, 1);
+		}
+	} else {
+		EventID id = EventID::lookup(luaL_checkstring(s, 2));
+		if (!id.valid())
+			return luaL_error(s, "unknown event '%s'", lua_tostring(s, 2));
+		events = id.getMask();
+	}
+	if (events == 0)
+		return luaL_error(s, "no events to wait for");
+
+	uint32 ticks = 0;
+	if (!lua_isnoneornil(s, 3)) {
+		lua_Number rounds = luaL_checknumber(s, 3);
+		ticks = rounds > 0 ? (uint32)ceil(rounds * TICKS_PER_ROUND) : 1;
+	}
+
+	if (!MScheduler.waitEvent(s, entity, events, ticks))
+		return luaL_error(s, "mud.waitEvent called outside of mud.spawn");
+	return lua_yield(s, 0);
+}
+
+/**
+ * name: mud.tagged
+ * param: string tag
+ * return: table of the active entities with the tag
+ */
+int tagged(lua_State* s)
+{
+	TagID tag = TagID::lookup(luaL_checkstring(s, 1));
+
+	// an unknown tag has no entities, so don't create it
+	if (!tag.valid()) {
+		lua_newtable(s);
+		return 1;
+	}
+
+	const EntityList& list = MEntity.tagList(tag);
+	lua_createtable(s, list.size(), 0);
+	int n = 0;
+	for (EntityList::const_iterator i = list.begin(); i != list.end(); ++i) {
+		(*i)->pushLuaTable();
+		if (s != Lua::state)
+			lua_xmove(Lua::state, s, 1);
+		lua_rawseti(s, -2, ++n);
+	}
+	return 1;
+}
+
 } // namespace bindings::mud
 
 // -------------------
@@ -25,6 +25,11 @@ void Lua::setPrint(IStreamSink* sink)
 	Lua::sink = sink;
 }
 
+IStreamSink* Lua::getPrint()
+{
+	return Lua::sink;
+}
+
 // this is our actual print function
 namespace
 {
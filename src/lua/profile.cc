@@ -0,0 +1,231 @@
+/*
+ * Source MUD
+ * Copyright (C) 2000-2005  Sean Middleditch
+ * See the file COPYING for license details
+ * http://www.sourcemud.org
+ */
+
+#include "common.h"
+#include "common/log.h"
+#include "common/time.h"
+#include "mud/settings.h"
+#include "mud/hooks.h"
+#include "lua/profile.h"
+#include "lib/lua51/lua.h"
+
+namespace Lua
+{
+	namespace Profile
+	{
+		bool running = false;
+	}
+}
+
+namespace {
+	// deepest stack recorded; recursion past it is cut off
+	const int MAX_DEPTH = 32;
+
+	struct Function {
+		uint64 self; // samples with this function running
+		uint64 total; // samples with this function anywhere on the stack
+		uint64 nsecs; // estimated time running
+	};
+	typedef std::map<std::string, Function> FunctionMap;
+	FunctionMap functions;
+
+	// folded stack, outermost frame first, to samples
+	typedef std::map<std::string, uint64> StackMap;
+	StackMap stacks;
+
+	struct HookCounts {
+		uint64 calls;
+		uint64 nsecs;
+		uint64 overruns;
+	};
+	HookCounts hooks_start[Hooks::COUNT];
+	HookCounts hooks_stop[Hooks::COUNT];
+
+	const char* root = NULL;
+	uint64 last = 0; // Time::nsecs() of the last sample or call
+	uint64 started = 0;
+	uint64 stopped = 0;
+	uint64 samples = 0;
+
+	void snapshotHooks(HookCounts* counts)
+	{
+		for (int i = 0; i < Hooks::COUNT; ++i) {
+			counts[i].calls = Hooks::slots[i].calls;
+			counts[i].nsecs = Hooks::slots[i].nsecs;
+			counts[i].overruns = Hooks::slots[i].overruns;
+		}
+	}
+
+	// "file:line name" for Lua functions, "[C] name" for C ones; ';'
+	// separates frames in folded stacks, so it can't appear in one
+	std::string frameName(lua_Debug& ar)
+	{
+		std::ostringstream name;
+		if (*ar.what == 'C')
+			name << "[C]";
+		else
+			name << ar.short_src << ":" << ar.linedefined;
+		if (ar.name != NULL)
+			name << " " << ar.name;
+
+		std::string label = name.str();
+		std::replace(label.begin(), label.end(), ';', ':');
+		return label;
+	}
+
+	bool bySelfTime(const FunctionMap::const_iterator& a, const FunctionMap::const_iterator& b)
+	{
+		return a->second.nsecs > b->second.nsecs;
+	}
+}
+
+void Lua::Profile::start()
+{
+	functions.clear();
+	stacks.clear();
+	samples = 0;
+	started = Time::nsecs();
+	last = started;
+	snapshotHooks(hooks_start);
+	running = true;
+	Log::Info << "Script profiler started";
+}
+
+void Lua::Profile::stop()
+{
+	if (!running)
+		return;
+	running = false;
+	stopped = Time::nsecs();
+	snapshotHooks(hooks_stop);
+	Log::Info << "Script profiler stopped after " << samples << " samples";
+}
+
+const char* Lua::Profile::enter(const char* s_root)
+{
+	const char* old_root = root;
+	if (s_root != NULL)
+		root = s_root;
+	if (running)
+		last = Time::nsecs();
+	return old_root;
+}
+
+void Lua::Profile::leave(const char* old_root)
+{
+	root = old_root;
+}
+
+void Lua::Profile::sample(lua_State* s)
+{
+	// charge the time since the last sample to this one
+	uint64 now = Time::nsecs();
+	uint64 elapsed = now - last;
+	last = now;
+
+	std::vector<std::string> frames;
+	lua_Debug ar;
+	for (int level = 0; level < MAX_DEPTH && lua_getstack(s, level, &ar); ++level) {
+		if (lua_getinfo(s, "Sn", &ar))
+			frames.push_back(frameName(ar));
+	}
+	if (frames.empty())
+		return;
+	++samples;
+
+	Function& leaf = functions[frames[0]];
+	++leaf.self;
+	leaf.nsecs += elapsed;
+
+	// count each function once per sample, however deep it recurses
+	for (size_t i = 0; i < frames.size(); ++i)
+		if (std::find(frames.begin(), frames.begin() + i, frames[i]) == frames.begin() + i)
+			++functions[frames[i]].total;
+
+	std::string folded = root != NULL ? root : "lua";
+	for (std::vector<std::string>::reverse_iterator i = frames.rbegin(); i != frames.rend(); ++i) {
+		folded += ';';
+		folded += *i;
+	}
+	++stacks[folded];
+}
+
+void Lua::Profile::report(std::ostream& out, size_t max_functions)
+{
+	// the hooks' counts at the end of the window
+	HookCounts now[Hooks::COUNT];
+	if (running)
+		snapshotHooks(now);
+	else
+		std::copy(hooks_stop, hooks_stop + Hooks::COUNT, now);
+
+	uint64 window = (running ? Time::nsecs() : stopped) - started;
+	char buffer[256];
+
+	out << "Profile " << (running ? "running" : "stopped") << ": "
+			<< window / 1000000 << "ms, " << samples << " samples\n";
+
+	out << "Hooks:\n";
+	snprintf(buffer, sizeof(buffer), "  %-22s %10s %10s %10s %8s\n", "Hook", "Calls", "Time(ms)", "Avg(us)", "Overruns");
+	out << buffer;
+	for (int i = 0; i < Hooks::COUNT; ++i) {
+		uint64 calls = now[i].calls - hooks_start[i].calls;
+		if (calls == 0)
+			continue;
+		uint64 nsecs = now[i].nsecs - hooks_start[i].nsecs;
+		snprintf(buffer, sizeof(buffer), "  %-22s %10llu %10llu %10llu %8llu\n",
+				Hooks::getName((Hooks::HookID)i), (unsigned long long)calls,
+				(unsigned long long)(nsecs / 1000000), (unsigned long long)(nsecs / calls / 1000),
+				(unsigned long long)(now[i].overruns - hooks_start[i].overruns));
+		out << buffer;
+	}
+
+	// functions by estimated self time
+	std::vector<FunctionMap::const_iterator> sorted;
+	uint64 total_nsecs = 0;
+	for (FunctionMap::const_iterator i = functions.begin(); i != functions.end(); ++i) {
+		sorted.push_back(i);
+		total_nsecs += i->second.nsecs;
+	}
+	std::sort(sorted.begin(), sorted.end(), bySelfTime);
+	if (sorted.size() > max_functions)
+		sorted.resize(max_functions);
+
+	out << "Functions:\n";
+	snprintf(buffer, sizeof(buffer), "  %6s %10s %8s %8s  %s\n", "Self%", "Self(ms)", "Self", "Total", "Function");
+	out << buffer;
+	for (std::vector<FunctionMap::const_iterator>::const_iterator i = sorted.begin(); i != sorted.end(); ++i) {
+		const Function& func = (*i)->second;
+		snprintf(buffer, sizeof(buffer), "  %5.1f%% %10.2f %8llu %8llu  %s\n",
+				total_nsecs ? 100.0 * func.nsecs / total_nsecs : 0.0, func.nsecs / 1000000.0,
+				(unsigned long long)func.self, (unsigned long long)func.total, (*i)->first.c_str());
+		out << buffer;
+	}
+}
+
+std::string Lua::Profile::dump()
+{
+	std::ostringstream path;
+	path << MSettings.getProfileFile() << "." << time(NULL);
+
+	FILE* file = fopen(path.str().c_str(), "w");
+	if (file == NULL) {
+		Log::Error << "Failed to open " << path.str() << " for writing: " << strerror(errno);
+		return std::string();
+	}
+
+	for (StackMap::const_iterator i = stacks.begin(); i != stacks.end(); ++i)
+		fprintf(file, "%s %llu\n", i->first.c_str(), (unsigned long long)i->second);
+
+	if (fclose(file) != 0) {
+		Log::Error << "Failed to write " << path.str() << ": " << strerror(errno);
+		return std::string();
+	}
+
+	Log::Info << "Wrote profile of " << stacks.size() << " stacks to " << path.str();
+	return path.str();
+}
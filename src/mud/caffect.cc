@@ -27,13 +27,15 @@ CreatureAffectType CreatureAffectType::lookup(const std::string& name)
 	return UNKNOWN;
 }
 
-CreatureAffectGroup::CreatureAffectGroup(const std::string& s_title, CreatureAffectType s_type, uint s_duration) : title(s_title), type(s_type), duration(s_duration)
+CreatureAffectGroup::CreatureAffectGroup(const std::string& s_title, CreatureAffectType s_type, uint s_duration) : title(s_title), type(s_type), duration(s_duration), periodic(false)
 {
 }
 
 int CreatureAffectGroup::addAffect(ICreatureAffect* affect)
 {
 	affects.push_back(affect);
+	if (affect->isPeriodic())
+		periodic = true;
 	return 0;
 }
 
@@ -51,10 +53,12 @@ void CreatureAffectGroup::remove(Creature* creature) const
 		(*i)->remove(creature);
 }
 
-void CreatureAffectGroup::update(Creature* creature)
+void CreatureAffectGroup::update(Creature* creature, uint elapsed)
 {
-	if (duration > 0)
-		--duration;
+	if (duration > elapsed)
+		duration -= elapsed;
+	else
+		duration = 0;
 
 	for (AffectList::const_iterator i = affects.begin(); i != affects.end(); ++i)
 		(*i)->update(creature);
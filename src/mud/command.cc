@@ -18,6 +18,7 @@
 #include "mud/help.h"
 #include "mud/room.h"
 #include "mud/object.h"
+#include "mud/trace.h"
 #include "mud/creature.h"
 #include "net/telnet.h"
 
@@ -189,6 +190,10 @@ int _MCommand::call(Creature *ch, const std::string& comm)
 			// do match
 			result = f->match(words, argv);
 			if (result == -1) {
+				if (command->trace_name == 0)
+					command->trace_name = Trace::intern(command->name);
+				Trace::record(Trace::COMMAND, command->trace_name, ch->getHandle().getSlot());
+
 				// all good - call function
 				if (f->ch_func) {
 					// call char functions
@@ -731,7 +736,7 @@ Creature::clFindObject(const std::string& line, int type, bool silent)
 
 	// do a sub search for on containers in the room, like tables
 	if (type & GOC_SUB && getRoom() != NULL) {
-		for (EList<Object>::iterator iter = getRoom()->objects.begin(); iter != getRoom()->objects.end(); ++iter) {
+		for (IndexedEList<Object>::iterator iter = getRoom()->objects.begin(); iter != getRoom()->objects.end(); ++iter) {
 			// have an ON container - search inside
 			if (*iter != NULL && (*iter)->hasLocation(ObjectLocation::ON)) {
 				if ((object = (*iter)->findObject(name, index, ObjectLocation::ON, &matches))) {
@@ -968,7 +973,7 @@ Entity* Creature::clFindAny(const std::string& line, bool silent)
 		index -= matches; // update count; subtract matches
 
 		// do a sub search for on containers, like tables
-		for (EList<Object>::iterator iter = getRoom()->objects.begin(); index > 0 && iter != getRoom()->objects.end(); ++iter) {
+		for (IndexedEList<Object>::iterator iter = getRoom()->objects.begin(); index > 0 && iter != getRoom()->objects.end(); ++iter) {
 			if (*iter != NULL) {
 				// have an ON container - search inside
 				if ((*iter)->hasLocation(ObjectLocation::ON)) {
@@ -148,7 +148,7 @@ void Creature::saveData(File::Writer& writer)
 	if (coins)
 		writer.attr("creature", "coins", coins);
 
-	writer.attr("creature", "hp", health.cur);
+	writer.attr("creature", "hp", getHP());
 
 	if (equipment.right_held)
 		equipment.right_held->save(writer, "creature", "equip_rhand");
@@ -174,12 +174,13 @@ int Creature::loadNode(File::Reader& reader, File::Node& node)
 	FO_PARENT(Entity)
 	FO_ATTR("creature", "dead")
 	dead = node.getBool();
+	updateMasks();
 	FO_ATTR("creature", "position")
 	position = CreaturePosition::lookup(node.getString());
 	FO_ATTR("creature", "coins")
 	coins = node.getInt();
 	FO_ATTR("creature", "hp")
-	health.cur = node.getInt();
+	setHP(node.getInt());
 
 	FO_ENTITY("creature", "equip_rhand")
 	if (OBJECT(entity) == NULL) throw File::Error("Equipment is not an Object");
@@ -212,12 +213,13 @@ int Creature::loadFinish()
 }
 
 // Creature
-Creature::Creature()
+Creature::Creature(EntityType s_type) : Entity(s_type)
 {
+	// take a slot in the store; everything in it starts at zero
+	slot = MCreatureStore.add(this);
+
 	position = CreaturePosition::STAND;
 	location = NULL;
-	health.cur = health.max = 0;
-	round_time = 0;
 	coins = 0;
 	dead = false;
 
@@ -226,9 +228,29 @@ Creature::Creature()
 	equipment.body_worn = NULL;
 	equipment.waist_worn = NULL;
 	equipment.back_worn = NULL;
+}
+
+Creature::~Creature()
+{
+	MCreatureStore.remove(slot);
+}
+
+void Creature::setEffectiveStat(CreatureStatID stat, int val)
+{
+	assert(stat);
+	if (!stat)
+		return;
+
+	MCreatureStore.stats[stat.getValue()][slot] = val;
 
-	for (int i = 0; i < CreatureStatID::COUNT; ++ i)
-		effective_stats[i] = 0;
+	if (stat.getValue() == CreatureStatID::FORTITUDE)
+		MCreatureStore.updateRegen(slot);
+}
+
+void Creature::updateMasks()
+{
+	MCreatureStore.active_mask[slot] = isActive() ? ~0U : 0U;
+	MCreatureStore.regen_mask[slot] = (isActive() && !dead) ? ~0U : 0U;
 }
 
 void Creature::setOwner(Entity* owner)
@@ -254,7 +276,7 @@ void Creature::addAction(IAction* action)
 
 	// only action on list?  initialize it
 	if (actions.size() == 1) {
-		round_time = 0;
+		roundTime() = 0;
 		if (action->start() != 0)
 			actions.erase(actions.begin());
 	}
@@ -285,7 +307,7 @@ void Creature::cancelAction()
 	}
 
 	// reset round time
-	round_time = 0;
+	roundTime() = 0;
 
 	// keep looping until we have an action that doesn't
 	// abort, or we are out of actions
@@ -309,9 +331,9 @@ uint Creature::getRoundTime() const
 	*/
 	uint rounds = actions.front()->getRounds();
 
-	if (rounds < round_time)
+	if (rounds < roundTime())
 		return 0;
-	return rounds - round_time;
+	return rounds - roundTime();
 }
 
 bool Creature::checkAlive()
@@ -413,7 +435,7 @@ bool Creature::enter(Room *new_room, Portal *old_portal)
 	if (old_room && old_zone != new_zone)
 		Events::sendLeaveZone(old_room, this, new_zone);
 	if (old_room && old_zone != new_zone)
-		Events::sendEnterZone(old_room, this, old_zone);
+		Events::sendEnterZone(new_room, this, old_zone);
 
 	doLook();
 
@@ -423,13 +445,15 @@ bool Creature::enter(Room *new_room, Portal *old_portal)
 void Creature::heal(uint amount)
 {
 	bool was_dead = isDead();
-	health.cur += amount;
+	int hp = getHP() + amount;
 	int max = getMaxHP();
-	if (health.cur > max)
-		health.cur = max;
+	if (hp > max)
+		hp = max;
+	setHP(hp);
 	// have we been resurrected?
-	if (health.cur > 0 && was_dead) {
+	if (hp > 0 && was_dead) {
 		dead = false;
+		updateMasks();
 		// FIXME EVENT
 	}
 }
@@ -440,11 +464,12 @@ bool Creature::damage(uint amount, Creature *trigger)
 	if (isDead())
 		return false;
 	// do damage and event
-	health.cur -= amount;
+	setHP(getHP() - amount);
 	// FIXME EVENT
 	// caused death?
-	if (health.cur <= 0 && !isDead()) {
+	if (getHP() <= 0 && !isDead()) {
 		dead = true;
+		updateMasks();
 		kill(trigger);
 		return true;
 	}
@@ -474,6 +499,7 @@ void Creature::heartbeat()
 	// pending actions?
 	if (!actions.empty()) {
 		// one round
+		uint& round_time = roundTime();
 		++round_time;
 
 		// last round?
@@ -502,23 +528,8 @@ void Creature::heartbeat()
 		}
 	}
 
-	// healing
-	if (!isDead() && (MUD::getRounds() % (50 - getEffectiveStat(CreatureStatID::FORTITUDE) / 5)) == 0) {
-		heal(1);
-	}
-
-	// affects
-	for (AffectStatusList::iterator i = affects.begin(); i != affects.end();) {
-		(*i)->update(this);
-
-		// affect expire?
-		if ((*i)->getTimeLeft() == 0) {
-			(*i)->remove(this);
-			i = affects.erase(i);
-		} else {
-			++i;
-		}
-	}
+	// healing and affect timers are run for all creatures
+	// at once by MCreatureStore.heartbeat()
 
 	// update handler
 	Hooks::creatureHeartbeat(this);
@@ -527,6 +538,7 @@ void Creature::heartbeat()
 void Creature::activate()
 {
 	Entity::activate();
+	updateMasks();
 
 	Object* obj;
 	for (int i = 0; (obj = getEquipAt(i)) != NULL; ++i)
@@ -540,6 +552,7 @@ void Creature::deactivate()
 		obj->deactivate();
 
 	Entity::deactivate();
+	updateMasks();
 }
 
 int Creature::macroProperty(const StreamControl& stream, const std::string& comm, const MacroList& argv) const
@@ -591,17 +604,17 @@ int Creature::macroProperty(const StreamControl& stream, const std::string& comm
 void Creature::recalcStats()
 {
 	for (int i = 0; i < CreatureStatID::COUNT; ++i)
-		effective_stats[i] = getBaseStat(i);
+		setEffectiveStat(i, getBaseStat(i));
 }
 
 // recalc max health
 void Creature::recalcHealth()
 {
-	health.max = (10 + getStatModifier(CreatureStatID::FORTITUDE)) * 10;
+	setMaxHP((10 + getStatModifier(CreatureStatID::FORTITUDE)) * 10);
 
 	// cap HP
-	if (health.cur > health.max)
-		health.cur = health.max;
+	if (getHP() > getMaxHP())
+		setHP(getMaxHP());
 }
 
 // recalculate various stuff
@@ -706,6 +719,8 @@ void Creature::displayEquip(const StreamControl& stream) const
 
 void Creature::displayAffects(const StreamControl& stream) const
 {
+	// durations may be behind, but nothing listed here has expired;
+	// groups are dropped on the very tick they run out
 	bool found = false;
 	for (AffectStatusList::const_iterator i = affects.begin(); i != affects.end(); ++i) {
 		if (!(*i)->getTitle().empty()) {
@@ -735,10 +750,42 @@ int Creature::addAffect(CreatureAffectGroup* affect)
 	if (affect->apply(this))
 		return -1;
 
+	// sync the existing affects first, so the new one doesn't
+	// get charged for time that passed before it was added
+	updateAffects();
 	affects.push_back(affect);
+	updateAffects();
 	return 0;
 }
 
+void Creature::updateAffects()
+{
+	uint elapsed = MCreatureStore.affect_elapsed[slot];
+	MCreatureStore.affect_elapsed[slot] = 0;
+
+	// apply elapsed time, drop expired affects, and find
+	// the time until the next one expires, or the next tick
+	// if any of them wants update() every tick
+	uint due = 0;
+	for (AffectStatusList::iterator i = affects.begin(); i != affects.end();) {
+		(*i)->update(this, elapsed);
+
+		// affect expire?
+		if ((*i)->getTimeLeft() == 0) {
+			(*i)->remove(this);
+			i = affects.erase(i);
+		} else {
+			if ((*i)->isPeriodic())
+				due = 1;
+			else if (due == 0 || (*i)->getTimeLeft() < due)
+				due = (*i)->getTimeLeft();
+			++i;
+		}
+	}
+
+	MCreatureStore.affect_due[slot] = due;
+}
+
 // events
 void Creature::handleEvent(const Event& event)
 {
@@ -0,0 +1,123 @@
+/*
+ * Source MUD
+ * Copyright (C) 2000-2005  Sean Middleditch
+ * See the file COPYING for license details
+ * http://www.sourcemud.org
+ */
+
+#include "common.h"
+#include "mud/cstore.h"
+#include "mud/creature.h"
+
+_MCreatureStore MCreatureStore;
+
+// the stat arrays are sized by a plain define so this header
+// doesn't have to pull in creature.h
+typedef char _cstore_stat_count_check[(CSTORE_STAT_COUNT == CreatureStatID::COUNT) ? 1 : -1];
+
+int _MCreatureStore::initialize()
+{
+	return 0;
+}
+
+void _MCreatureStore::shutdown()
+{
+}
+
+uint32 _MCreatureStore::add(Creature* creature)
+{
+	uint32 slot = owner.size();
+
+	owner.push_back(creature);
+	hp.push_back(0);
+	max_hp.push_back(0);
+	for (int i = 0; i < CSTORE_STAT_COUNT; ++i)
+		stats[i].push_back(0);
+	round_time.push_back(0);
+	regen_rate.push_back(0);
+	regen_acc.push_back(0);
+	regen_mask.push_back(0);
+	affect_due.push_back(0);
+	affect_elapsed.push_back(0);
+	active_mask.push_back(0);
+
+	return slot;
+}
+
+void _MCreatureStore::remove(uint32 slot)
+{
+	assert(slot < owner.size());
+
+	// move the last creature into the hole
+	uint32 last = owner.size() - 1;
+	if (slot != last) {
+		owner[slot] = owner[last];
+		hp[slot] = hp[last];
+		max_hp[slot] = max_hp[last];
+		for (int i = 0; i < CSTORE_STAT_COUNT; ++i)
+			stats[i][slot] = stats[i][last];
+		round_time[slot] = round_time[last];
+		regen_rate[slot] = regen_rate[last];
+		regen_acc[slot] = regen_acc[last];
+		regen_mask[slot] = regen_mask[last];
+		affect_due[slot] = affect_due[last];
+		affect_elapsed[slot] = affect_elapsed[last];
+		active_mask[slot] = active_mask[last];
+
+		owner[slot]->slot = slot;
+	}
+
+	owner.pop_back();
+	hp.pop_back();
+	max_hp.pop_back();
+	for (int i = 0; i < CSTORE_STAT_COUNT; ++i)
+		stats[i].pop_back();
+	round_time.pop_back();
+	regen_rate.pop_back();
+	regen_acc.pop_back();
+	regen_mask.pop_back();
+	affect_due.pop_back();
+	affect_elapsed.pop_back();
+	active_mask.pop_back();
+}
+
+void _MCreatureStore::updateRegen(uint32 slot)
+{
+	// one HP every (50 - FORT/5) rounds' worth of ticks, the
+	// same rate the old modulo check in Creature::heartbeat() gave
+	int period = 50 - stats[CreatureStatID::FORTITUDE][slot] / 5;
+	if (period < 1)
+		period = 1;
+	regen_rate[slot] = 0x10000 / period;
+}
+
+void _MCreatureStore::heartbeat()
+{
+	const size_t count = owner.size();
+	bool expired = false;
+
+	// regeneration and affect timers; no branches or calls, so
+	// the compiler is free to vectorize this
+	for (size_t i = 0; i < count; ++i) {
+		uint32 acc = regen_acc[i] + (regen_rate[i] & regen_mask[i]);
+		int heal = acc >> 16;
+		int cur = hp[i] + heal;
+		int cap = cur < max_hp[i] ? cur : max_hp[i];
+		hp[i] = heal ? cap : hp[i];
+		regen_acc[i] = acc & 0xFFFF;
+
+		uint32 due = affect_due[i];
+		uint32 step = (due != 0) & active_mask[i];
+		affect_due[i] = due - step;
+		affect_elapsed[i] += step;
+		expired |= (due == 1) & step;
+	}
+
+	// let creatures whose next affect just ran out deal with it
+	if (expired) {
+		for (size_t i = 0; i < owner.size(); ++i) {
+			if (affect_due[i] == 0 && affect_elapsed[i] != 0)
+				owner[i]->updateAffects();
+		}
+	}
+}
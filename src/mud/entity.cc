@@ -10,42 +10,109 @@
 #include "common/string.h"
 #include "common/streams.h"
 #include "mud/entity.h"
+#include "mud/elist.h"
 #include "mud/server.h"
 #include "mud/macro.h"
 #include "mud/color.h"
 #include "mud/player.h"
 #include "mud/clock.h"
 #include "mud/hooks.h"
+#include "mud/room.h"
+#include "mud/scheduler.h"
+#include "lua/core.h"
+#include "lib/lua51/lua.h"
+#include "lib/lua51/lauxlib.h"
 
 // ----- Entity -----
 
-Entity::Entity() : state(FLOAT)
+Entity::Entity(EntityType s_type) : state(FLOAT), entity_type(s_type), event_mask(0), wait_mask(0), elist(NULL), elist_index(0), lua_udata(0), lua_name_ref(0)
 {
 	// add to the dead list; we move to the live list
 	// only if we get activated
-	link_prev = NULL;
-	link_next = MEntity.dead;
-	if (link_next)
-		link_next->link_prev = this;
-	MEntity.dead = this;
+	MEntity.addDead(this);
 
-	// create Lua object
-	Lua::createObject(this, "Entity");
+	// take a handle slot
+	handle = EntityHandle::acquire(this);
 }
 
 Entity::~Entity()
 {
-	// release our Lua object
-	Lua::releaseObject(this);
+	// entities freed without destroy(), like the rooms of a zone,
+	// still take their threads and waits with them
+	MScheduler.cancel(this, true);
+
+	// release our Lua object; it holds our handle, which goes stale
+	// below, so scripts still holding it get an error, not a crash
+	if (Lua::state != NULL) {
+		if (lua_udata != 0)
+			luaL_unref(Lua::state, LUA_REGISTRYINDEX, lua_udata);
+		if (lua_name_ref != 0)
+			luaL_unref(Lua::state, LUA_REGISTRYINDEX, lua_name_ref);
+	}
+
+	// free event handlers
+	for (EventList::iterator i = events.begin(); i != events.end(); ++i)
+		delete *i;
+
+	// invalidate outstanding handles
+	EntityHandle::release(handle);
+}
+
+void Entity::pushLuaTable() const
+{
+	if (lua_udata == 0) {
+		EntityHandle* udata = (EntityHandle*)lua_newuserdata(Lua::state, sizeof(EntityHandle));
+		*udata = handle;
+		luaL_getmetatable(Lua::state, "Entity");
+		lua_setmetatable(Lua::state, -2);
+		lua_udata = luaL_ref(Lua::state, LUA_REGISTRYINDEX);
+	}
+
+	lua_rawgeti(Lua::state, LUA_REGISTRYINDEX, lua_udata);
+}
+
+void Entity::pushLuaName() const
+{
+	if (lua_name_ref == 0) {
+		lua_pushstring(Lua::state, getName().getFull().c_str());
+		lua_name_ref = luaL_ref(Lua::state, LUA_REGISTRYINDEX);
+	}
+
+	lua_rawgeti(Lua::state, LUA_REGISTRYINDEX, lua_name_ref);
 }
 
 EventHandler* Entity::getEvent(EventID name)
 {
-	for (EventList::iterator i = events.begin(); i != events.end(); ++i) {
-		if ((*i)->getEvent() == name)
-			return *i;
+	return (event_mask & name.getMask()) ? event_table[name.getValue()] : NULL;
+}
+
+void Entity::addEvent(EventHandler* handler)
+{
+	events.push_back(handler);
+
+	// the first handler for an event is the one that runs
+	EventID id = handler->getEvent();
+	if (id.valid() && !(event_mask & id.getMask())) {
+		if (event_table.empty())
+			event_table.resize(EventID::COUNT, NULL);
+		event_table[id.getValue()] = handler;
+		event_mask |= id.getMask();
 	}
-	return NULL;
+}
+
+void Entity::setWaitMask(EventMask mask)
+{
+	EventMask old_mask = getEventMask();
+	wait_mask = mask;
+	if (getEventMask() != old_mask)
+		eventMaskChanged(old_mask);
+}
+
+void Entity::eventMaskChanged(EventMask old_mask)
+{
+	Room* room = ROOM(getOwner());
+	if (room != NULL)
+		room->updateSubscriber(old_mask, getEventMask());
 }
 
 void Entity::activate()
@@ -56,24 +123,13 @@ void Entity::activate()
 	// set as active
 	state = ACTIVE;
 
-	// remove from dead list
-	if (link_next)
-		link_next->link_prev = link_prev;
-	if (link_prev)
-		link_prev->link_next = link_next;
-	if (this == MEntity.dead)
-		MEntity.dead = link_next;
-
-	// add to active list
-	link_prev = NULL;
-	link_next = MEntity.all;
-	if (link_next)
-		link_next->link_prev = this;
-	MEntity.all = this;
+	// move from dead list to active list
+	MEntity.removeDead(this);
+	MEntity.addActive(this);
 
 	// register tags
 	for (TagList::iterator i = tags.begin(); i != tags.end(); ++i)
-		MEntity.tag_map.insert(std::pair<TagID, Entity*> (*i, this));
+		MEntity.addTagged(this, *i);
 }
 
 void Entity::deactivate()
@@ -84,39 +140,20 @@ void Entity::deactivate()
 	// quite dead, thank you
 	state = DEAD;
 
-	// if we're the next heartbeat target, update the heartbeat pointer
-	if (this == MEntity.next)
-		MEntity.next = link_next;
-
-	// remove from active list
-	if (link_next)
-		link_next->link_prev = link_prev;
-	if (link_prev)
-		link_prev->link_next = link_next;
-	if (this == MEntity.all)
-		MEntity.all = link_next;
-
-	// add to dead list
-	link_prev = NULL;
-	link_next = MEntity.dead;
-	if (link_next)
-		link_next->link_prev = this;
-	MEntity.dead = this;
+	// move from active list to dead list
+	MEntity.removeActive(this);
+	MEntity.addDead(this);
 
 	// TAG MAP
-	for (TagList::iterator i = tags.begin(); i != tags.end(); ++i) {
-		std::pair<TagTable::iterator, TagTable::iterator> mi = MEntity.tag_map.equal_range(*i);
-		while (mi.first != mi.second) {
-			if (mi.first->second == this)
-				MEntity.tag_map.erase(mi.first++);
-			else
-				++mi.first;
-		}
-	}
+	while (!tag_slots.empty())
+		MEntity.removeTagged(this, tag_slots.back().first);
 }
 
 void Entity::destroy()
 {
+	// scripts running on our behalf stop here
+	MScheduler.cancel(this);
+
 	Entity* owner = getOwner();
 	if (owner != NULL)
 		owner->ownerRelease(this);
@@ -132,6 +169,23 @@ bool Entity::nameMatch(const std::string& match) const
 	return false;
 }
 
+void Entity::getMatchWords(std::vector<std::string>& words) const
+{
+	getName().getTokens().getWords(words);
+}
+
+void Entity::nameChanged()
+{
+	if (elist != NULL)
+		elist->reindex(this);
+
+	if (lua_name_ref != 0) {
+		if (Lua::state != NULL)
+			luaL_unref(Lua::state, LUA_REGISTRYINDEX, lua_name_ref);
+		lua_name_ref = 0;
+	}
+}
+
 void Entity::displayDesc(const StreamControl& stream) const
 {
 	stream << StreamMacro(getDesc()).set("self", this);
@@ -212,7 +266,9 @@ FO_NODE_BEGIN
 	FO_OBJECT("entity", "event")
 		EventHandler* event = new EventHandler();
 		if (!event->load(reader))
-			events.push_back(event);
+			addEvent(event);
+		else
+			delete event;
 FO_NODE_END
 }
 
@@ -279,9 +335,8 @@ int Entity::addTag(TagID tag)
 	tags.insert(tag);
 
 	// register with entity manager
-	// FIXME: check for error, maybe?
 	if (isActive())
-		MEntity.tag_map.insert(std::pair<TagID, Entity*> (tag, this));
+		MEntity.addTagged(this, tag);
 
 	return 0;
 }
@@ -297,20 +352,10 @@ int Entity::removeTag(TagID tag)
 	tags.erase(ti);
 
 	// unregister with entity manager
-	if (isActive()) {
-		std::pair<TagTable::iterator, TagTable::iterator> mi = MEntity.tag_map.equal_range(tag);
-		while (mi.first != mi.second) {
-			if (mi.first->second == this) {
-				MEntity.tag_map.erase(mi.first);
-				return 0;
-			}
-			++mi.first;
-		}
-		return 2; // failed to find in manager
-	} else {
-		// no active - no need to unregister
-		return 0;
-	}
+	if (isActive())
+		MEntity.removeTagged(this, tag);
+
+	return 0;
 }
 
 void Entity::setOwner(Entity* owner)
@@ -357,43 +402,187 @@ void _MEntity::shutdown()
 
 void _MEntity::heartbeat()
 {
-	// loop over all entities, running the heartbeat method.
-	// keep track of the next entity to be run, so that
-	// entity destruction won't screw us up.  also note that
-	// entity creation won't screw us up, because entities
-	// are always added to the front of the list.
-	Entity* next = NULL;
-	Entity* cur = all;
-	while (cur != NULL) {
-		next = cur->link_next;
-		cur->heartbeat();
-		cur = next;
+	// snapshot the size of every list before running anything, so
+	// entities activated during the pass (of any type) wait for
+	// the next heartbeat
+	for (int type = 0; type < ET_COUNT; ++type) {
+		active[type].cursor = 0;
+		active[type].end = active[type].list.size();
 	}
+
+	// run the heartbeats; removeActive() keeps cursor and end
+	// correct if entities are destroyed along the way
+	for (int type = 0; type < ET_COUNT; ++type) {
+		ActiveList& al = active[type];
+		while (al.cursor < al.end)
+			al.list[al.cursor++]->heartbeat();
+	}
+
+	for (int type = 0; type < ET_COUNT; ++type)
+		active[type].cursor = active[type].end = 0;
+}
+
+void _MEntity::addActive(Entity* entity)
+{
+	ActiveList& al = active[entity->entityType()];
+	entity->registry_index = al.list.size();
+	al.list.push_back(entity);
+}
+
+void _MEntity::removeActive(Entity* entity)
+{
+	ActiveList& al = active[entity->entityType()];
+	size_t hole = entity->registry_index;
+	assert(hole < al.list.size() && al.list[hole] == entity);
+
+	// fill the hole with the last entity of its own segment, which
+	// moves the hole to the start of the following segment
+	if (hole < al.cursor) {
+		--al.cursor;
+		al.list[hole] = al.list[al.cursor];
+		al.list[hole]->registry_index = hole;
+		hole = al.cursor;
+	}
+	if (hole < al.end) {
+		--al.end;
+		al.list[hole] = al.list[al.end];
+		al.list[hole]->registry_index = hole;
+		hole = al.end;
+	}
+	al.list[hole] = al.list.back();
+	al.list[hole]->registry_index = hole;
+	al.list.pop_back();
+}
+
+void _MEntity::addDead(Entity* entity)
+{
+	entity->registry_index = dead.size();
+	dead.push_back(entity);
+}
+
+void _MEntity::removeDead(Entity* entity)
+{
+	size_t index = entity->registry_index;
+	assert(index < dead.size() && dead[index] == entity);
+
+	dead[index] = dead.back();
+	dead[index]->registry_index = index;
+	dead.pop_back();
 }
 
 size_t _MEntity::tagCount(TagID tag) const
 {
-	return tag_map.count(tag);
+	TagTable::const_iterator i = tag_map.find(tag);
+	return i != tag_map.end() ? i->second.size() : 0;
 }
 
-std::pair<TagTable::const_iterator, TagTable::const_iterator> _MEntity::tagList(TagID tag) const
+const EntityList& _MEntity::tagList(TagID tag) const
 {
-	return tag_map.equal_range(tag);
+	static const EntityList empty;
+
+	TagTable::const_iterator i = tag_map.find(tag);
+	return i != tag_map.end() ? i->second : empty;
 }
 
-void _MEntity::collect()
+void _MEntity::addTagged(Entity* entity, TagID tag)
 {
-	// delete all dead entities
+	EntityList& list = tag_map[tag];
+	entity->tag_slots.push_back(std::make_pair(tag, list.size()));
+	list.push_back(entity);
+}
+
+void _MEntity::removeTagged(Entity* entity, TagID tag)
+{
+	// find our slot; entities only have a handful of tags
+	Entity::TagSlots::iterator slot = entity->tag_slots.begin();
+	while (slot != entity->tag_slots.end() && !(slot->first == tag))
+		++slot;
+	assert(slot != entity->tag_slots.end());
+
+	TagTable::iterator ti = tag_map.find(tag);
+	assert(ti != tag_map.end());
+	EntityList& list = ti->second;
+	size_t index = slot->second;
+	assert(index < list.size() && list[index] == entity);
+
+	// swap-remove, fixing up the slot of the entity we moved
+	Entity* moved = list.back();
+	list[index] = moved;
+	list.pop_back();
+	if (moved != entity) {
+		for (Entity::TagSlots::iterator i = moved->tag_slots.begin(); i != moved->tag_slots.end(); ++i) {
+			if (i->first == tag) {
+				i->second = index;
+				break;
+			}
+		}
+	}
+
+	// drop empty lists so tagListCount() stays meaningful
+	if (list.empty())
+		tag_map.erase(ti);
+
+	*slot = entity->tag_slots.back();
+	entity->tag_slots.pop_back();
+}
+
+void _MEntity::collect(uint64 max_nsecs, size_t max_count)
+{
+	uint64 start = max_nsecs ? Time::nsecs() : 0;
+	size_t count = 0;
+
+	// delete dead entities
 	// we remove the entity from the list first, then we
 	// delete it, just incase the destructor kills some
 	// more entities; that shouldn't happen, but better
 	// safe than sorry.
-	while (dead != NULL) {
-		Entity* e = dead;
-		dead = dead->link_next;
-		if (dead != NULL)
-			dead->link_prev = NULL;
+	while (!dead.empty()) {
+		Entity* e = dead.back();
+		dead.pop_back();
 
 		delete e;
+
+		// out of budget?  the rest wait for the next call
+		if (max_count && ++count >= max_count)
+			break;
+		if (max_nsecs && Time::nsecs() - start >= max_nsecs)
+			break;
 	}
+
+	// hand the freed memory back to the entity pools
+	EntityPool::collectAll();
+}
+
+// ----- EntityHandle -----
+
+std::vector<EntityHandle::Slot> EntityHandle::slots(1);
+std::vector<uint32> EntityHandle::free_slots;
+
+EntityHandle EntityHandle::acquire(Entity* entity)
+{
+	EntityHandle handle;
+
+	// reuse a free slot; its generation was bumped on release
+	if (!free_slots.empty()) {
+		handle.slot = free_slots.back();
+		free_slots.pop_back();
+	} else {
+		handle.slot = slots.size();
+		Slot fresh = { NULL, 1 };
+		slots.push_back(fresh);
+	}
+
+	slots[handle.slot].entity = entity;
+	handle.generation = slots[handle.slot].generation;
+	return handle;
+}
+
+void EntityHandle::release(EntityHandle handle)
+{
+	Slot& slot = slots[handle.slot];
+	assert(handle.slot != 0 && slot.generation == handle.generation);
+
+	slot.entity = NULL;
+	++slot.generation;
+	free_slots.push_back(handle.slot);
 }
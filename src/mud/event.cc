@@ -6,12 +6,36 @@
  */
 
 #include "common.h"
+#include "common/time.h"
 #include "mud/entity.h"
 #include "mud/server.h"
 #include "mud/room.h"
+#include "mud/zone.h"
+#include "mud/creature.h"
+#include "mud/object.h"
+#include "mud/portal.h"
+#include "mud/trace.h"
+#include "mud/scheduler.h"
+#include "lua/core.h"
+#include "lua/exec.h"
+#include "lib/lua51/lua.h"
+#include "lib/lua51/lauxlib.h"
 
 _MEvent MEvent;
 
+namespace {
+	// trace name ids for each event
+	uint16 trace_names[EventID::COUNT];
+
+	inline EntityHandle handleOf(Entity* entity)
+	{
+		return entity != NULL ? entity->getHandle() : EntityHandle();
+	}
+}
+
+// event masks are a single word
+typedef char _event_mask_check[(EventID::COUNT <= 32) ? 1 : -1];
+
 std::string EventID::names[] = {
 	"None",
 	"Look",
@@ -28,6 +52,24 @@ std::string EventID::names[] = {
 	"PickupItem",
 };
 
+// events that are pure notifications, where a back-to-back repeat
+// tells the recipient nothing new
+const bool EventID::coalesce[] = {
+	false, // None
+	true,  // Look
+	true,  // LeaveRoom
+	true,  // EnterRoom
+	true,  // LeaveZone
+	true,  // EnterZone
+	true,  // TouchItem
+	true,  // GraspItem
+	true,  // ReleaseItem
+	false, // GetItem
+	false, // PutItem
+	false, // DropItem
+	false, // PickupItem
+};
+
 EventID EventID::lookup(const std::string& name)
 {
 	for (size_t i = 0; i < COUNT; ++i)
@@ -36,10 +78,18 @@ EventID EventID::lookup(const std::string& name)
 	return EventID();
 }
 
-EventHandler::EventHandler() : event(), script() {}
+EventHandler::EventHandler() : event(), script(), func(LUA_NOREF) {}
+
+EventHandler::~EventHandler()
+{
+	if (func != LUA_NOREF)
+		MEvent.release(script);
+}
 
 int EventHandler::load(File::Reader& reader)
 {
+	size_t line = 0;
+
 	FO_READ_BEGIN
 	FO_ATTR("event", "id")
 	event = EventID::lookup(node.getString());
@@ -47,10 +97,15 @@ int EventHandler::load(File::Reader& reader)
 		Log::Warning << node << ": Unknown event '" << node.getString() << "'";
 	FO_ATTR("event", "script")
 	script = node.getString();
+	line = node.getLine();
 	FO_READ_ERROR
 	return -1;
 	FO_READ_END
 
+	// compile now, so triggering the event is just a call
+	if (event.valid() && !script.empty())
+		func = MEvent.compile(event, script, reader.getFilename(), line);
+
 	return 0;
 }
 
@@ -61,23 +116,85 @@ void EventHandler::save(File::Writer& writer) const
 		writer.block("event", "script", script);
 }
 
+void EventHandler::run(Entity* self, const Event& ev) const
+{
+	if (func == LUA_NOREF)
+		return;
+
+	Lua::ExecRef exec(func);
+	exec.param(ev.getId().getName());
+	exec.param(self);
+	exec.param(ev.getAux1());
+	exec.param(ev.getAux2());
+	exec.param(ev.getAux3());
+	exec.run();
+}
+
 void Entity::handleEvent(const Event& event)
 {
-	for (EventList::const_iterator i = events.begin(); i != events.end(); ++ i) {
-		if (event.getId() == (*i)->getEvent()) {
-			//(*i)->getFunc().run(len, argv);
-		}
-	}
+	// we may only be listening for a script's mud.waitEvent
+	if (!(event_mask & event.getId().getMask()))
+		return;
+
+	EventHandler* handler = event_table[event.getId().getValue()];
+	if (handler != NULL)
+		handler->run(this, event);
 }
 
 int _MEvent::initialize()
 {
+	for (int i = 0; i < EventID::COUNT; ++i)
+		trace_names[i] = Trace::intern(EventID(i).getName());
+
+	ring.resize(256);
+	head = 0;
+	queued = 0;
 	return 0;
 }
 
 void _MEvent::shutdown()
 {
-	events.clear();
+	// handlers still alive release into an empty map
+	if (Lua::state != NULL)
+		for (CompiledMap::iterator i = compiled.begin(); i != compiled.end(); ++i)
+			luaL_unref(Lua::state, LUA_REGISTRYINDEX, i->second.ref);
+	compiled.clear();
+
+	std::vector<Event>().swap(ring);
+	std::vector<uint64>().swap(last_queued);
+	head = 0;
+	queued = 0;
+}
+
+void _MEvent::push(const Event& event)
+{
+	// merge with the last event queued for the same recipient if it
+	// is still pending and identical; only the last one is checked,
+	// so the recipient still sees changes in the order they happened
+	uint32 slot = event.recipient.getSlot();
+	if (slot >= last_queued.size())
+		last_queued.resize(EntityHandle::getSlotCount(), 0);
+	uint64 last = last_queued[slot];
+	if (last > popped && event.getId().coalesces() &&
+			ring[(head + (last - 1 - popped)) & (ring.size() - 1)] == event) {
+		++coalesced;
+		return;
+	}
+	last_queued[slot] = ++pushed;
+
+	// full; double the ring, unwrapping the pending events to the
+	// front of the new one
+	if (queued == ring.size()) {
+		std::vector<Event> grown(ring.empty() ? 256 : ring.size() * 2);
+		for (size_t i = 0; i < queued; ++i)
+			grown[i] = ring[(head + i) & (ring.size() - 1)];
+		ring.swap(grown);
+		head = 0;
+	}
+
+	ring[(head + queued) & (ring.size() - 1)] = event;
+	if (++queued > peak)
+		peak = queued;
 }
 
 void _MEvent::send(EventID id, Entity* recipient, Entity* aux1, Entity* aux2, Entity* aux3)
@@ -85,16 +202,20 @@ void _MEvent::send(EventID id, Entity* recipient, Entity* aux1, Entity* aux2, En
 	assert(id.valid());
 	assert(recipient != NULL);
 
+	// nobody listening
+	if (!recipient->handlesEvent(id))
+		return;
+
 	// create event
 	Event event;
 	event.id = id;
-	event.recipient = recipient;
-	event.aux1 = aux1;
-	event.aux2 = aux2;
-	event.aux3 = aux3;
+	event.recipient = recipient->getHandle();
+	event.aux1 = handleOf(aux1);
+	event.aux2 = handleOf(aux2);
+	event.aux3 = handleOf(aux3);
 
 	// just queue it, doesn't need to happen now
-	events.push_back(event);
+	push(event);
 }
 
 void _MEvent::broadcast(EventID id, Entity* recipient, Entity* aux1, Entity* aux2, Entity* aux3)
@@ -105,120 +226,196 @@ void _MEvent::broadcast(EventID id, Entity* recipient, Entity* aux1, Entity* aux
 	// create event
 	Event event;
 	event.id = id;
-	event.recipient = recipient;
-	event.aux1 = aux1;
-	event.aux2 = aux2;
-	event.aux3 = aux3;
+	event.recipient = recipient->getHandle();
+	event.aux1 = handleOf(aux1);
+	event.aux2 = handleOf(aux2);
+	event.aux3 = handleOf(aux3);
 
 	// ask entity to broadcast it
 	recipient->broadcastEvent(event);
 }
 
+void _MEvent::broadcast(EventID id, Zone* zone, Entity* aux1, Entity* aux2, Entity* aux3)
+{
+	assert(id.valid());
+	assert(zone != NULL);
+
+	// create event; the zone fills in each room as recipient
+	Event event;
+	event.id = id;
+	event.aux1 = handleOf(aux1);
+	event.aux2 = handleOf(aux2);
+	event.aux3 = handleOf(aux3);
+
+	zone->broadcastEvent(event);
+}
+
 void _MEvent::resend(const Event& event, Entity* recipient)
 {
+	// nobody listening
+	if (!recipient->handlesEvent(event.getId()))
+		return;
+
 	Event new_event = event;
-	new_event.recipient = recipient;
-	events.push_back(new_event);
+	new_event.recipient = recipient->getHandle();
+	push(new_event);
 }
 
-void _MEvent::process()
+void _MEvent::process(uint64 max_nsecs, size_t max_count)
 {
+	uint64 start = max_nsecs ? Time::nsecs() : 0;
+
 	// remember how many events we started with
 	// this way, events which trigger more events
 	// won't cause an infinite loop, because we'll
 	// only process the initial batch
-	size_t processing = events.size();
+	size_t processing = queued;
+	if (max_count && processing > max_count)
+		processing = max_count;
 
 	// as long as we have events...
-	while (processing > 0 && !events.empty()) {
+	while (processing > 0 && queued != 0) {
 		// get event
-		Event event = events.front();
-		events.pop_front();
+		Event event = ring[head];
+		head = (head + 1) & (ring.size() - 1);
+		--queued;
 		--processing;
+		++popped;
 
-		// DEBUG:
-		/*
-		Log::Info << "Event[" << event.getName() <<
-			"] P:" << event.getId().name() <<
-			" R:" << (event.getRoom() ? event.getRoom()->getId().c_str() : "n/a") <<
-			" A:" << (event.getActor() ? event.getActor()->getName().getName().c_str() : "n/a") <<
-			" D:" << (event.getData(0) ? event.getData(0).getType()->getName().name().c_str() : "n/a") <<
-			" D:" << (event.getData(1) ? event.getData(1).getType()->getName().name().c_str() : "n/a") <<
-			" D:" << (event.getData(2) ? event.getData(2).getType()->getName().name().c_str() : "n/a") <<
-			" D:" << (event.getData(3) ? event.getData(3).getType()->getName().name().c_str() : "n/a") <<
-			" D:" << (event.getData(4) ? event.getData(4).getType()->getName().name().c_str() : "n/a");
-		*/
+		Trace::record(Trace::EVENT, trace_names[event.getId().getValue()], event.recipient.getSlot());
+
+		// send event, unless the recipient has since been freed
+		Entity* recipient = event.getRecipient();
+		if (recipient != NULL) {
+			recipient->handleEvent(event);
+			MScheduler.deliver(recipient, event);
+		}
 
-		// send event
-		event.getRecipient()->handleEvent(event);
+		// out of time?  the rest wait for the next call
+		if (max_nsecs && Time::nsecs() - start >= max_nsecs)
+			break;
 	}
 }
 
 int _MEvent::compile(EventID id, const std::string& source, const std::string& filename, unsigned long fileline)
 {
-	return 0;
+	// already compiled?
+	CompiledMap::iterator i = compiled.find(source);
+	if (i != compiled.end()) {
+		++i->second.users;
+		return i->second.ref;
+	}
+
+	// the handler body becomes a function of the event arguments;
+	// the prologue shares the first line so line numbers still match
+	std::string code = "local event, self, aux1, aux2, aux3 = ...; " + source;
+	std::ostringstream chunk;
+	chunk << "=" << filename << ":" << fileline << " (" << id.getName() << ")";
+
+	if (luaL_loadbuffer(Lua::state, code.c_str(), code.size(), chunk.str().c_str()) != 0) {
+		Log::Error << "Couldn't compile event handler: " << lua_tostring(Lua::state, -1);
+		lua_pop(Lua::state, 1);
+		return LUA_NOREF;
+	}
+
+	Compiled entry;
+	entry.ref = luaL_ref(Lua::state, LUA_REGISTRYINDEX);
+	entry.users = 1;
+	compiled[source] = entry;
+	return entry.ref;
+}
+
+void _MEvent::release(const std::string& source)
+{
+	CompiledMap::iterator i = compiled.find(source);
+	if (i == compiled.end())
+		return;
+
+	if (--i->second.users == 0) {
+		luaL_unref(Lua::state, LUA_REGISTRYINDEX, i->second.ref);
+		compiled.erase(i);
+	}
 }
 
 namespace Events
 {
+	namespace {
+		// deliver an event to a room and everything in it
+		void sendRoom(EventID id, Room* room, Entity* aux1, Entity* aux2 = NULL, Entity* aux3 = NULL)
+		{
+			if (room == NULL)
+				return;
+			MEvent.send(id, room, aux1, aux2, aux3);
+			MEvent.broadcast(id, room, aux1, aux2, aux3);
+		}
+
+		// deliver an event to every room in the room's zone
+		void sendZone(EventID id, Room* room, Entity* aux1)
+		{
+			if (room == NULL || room->getZone() == NULL)
+				return;
+			MEvent.broadcast(id, room->getZone(), aux1);
+		}
+	}
+
 	void sendLook(Room* room, Creature* actor, Entity* target)
 	{
-		/*EventManager.send(EventID::Look,room,actor,target,aux);*/
+		sendRoom(EventID::LOOK, room, actor, target);
 	}
 
 	void sendLeaveRoom(Room* room, Creature* actor, Portal* aux, Room* arg_dest)
 	{
-		/*EventManager.send(EventID::LeaveRoom,room,actor,target,aux,arg_dest);*/
+		sendRoom(EventID::LEAVE_ROOM, room, actor, aux, arg_dest);
 	}
 
 	void sendEnterRoom(Room* room, Creature* actor, Portal* aux, Room* arg_from)
 	{
-		/*EventManager.send(EventID::EnterRoom,room,actor,target,aux,arg_from);*/
+		sendRoom(EventID::ENTER_ROOM, room, actor, aux, arg_from);
 	}
 
 	void sendLeaveZone(Room* room, Creature* actor, Zone* arg_dest)
 	{
-		/*EventManager.send(EventID::LeaveZone,room,actor,target,aux,arg_dest);*/
+		sendZone(EventID::LEAVE_ZONE, room, actor);
 	}
 
 	void sendEnterZone(Room* room, Creature* actor, Zone* arg_from)
 	{
-		/*EventManager.send(EventID::EnterZone,room,actor,target,aux,arg_from);*/
+		sendZone(EventID::ENTER_ZONE, room, actor);
 	}
 
 	void sendTouchItem(Room* room, Creature* actor, Object* target)
 	{
-		/*EventManager.send(EventID::TouchItem,room,actor,target,aux);*/
+		sendRoom(EventID::TOUCH_ITEM, room, actor, target);
 	}
 
 	void sendGraspItem(Room* room, Creature* actor, Object* target)
 	{
-		/*EventManager.send(EventID::GraspItem,room,actor,target,aux);*/
+		sendRoom(EventID::GRASP_ITEM, room, actor, target);
 	}
 
 	void sendReleaseItem(Room* room, Creature* actor, Object* target)
 	{
-		/*EventManager.send(EventID::ReleaseItem,room,actor,target,aux);*/
+		sendRoom(EventID::RELEASE_ITEM, room, actor, target);
 	}
 
 	void sendGetItem(Room* room, Creature* actor, Object* target, Object* aux, const std::string& arg_)
 	{
-		/*EventManager.send(EventID::GetItem,room,actor,target,aux,arg_);*/
+		sendRoom(EventID::GET_ITEM, room, actor, target, aux);
 	}
 
 	void sendPutItem(Room* room, Creature* actor, Object* target, Object* aux, const std::string& arg_)
 	{
-		/*EventManager.send(EventID::PutItem,room,actor,target,aux,arg_);*/
+		sendRoom(EventID::PUT_ITEM, room, actor, target, aux);
 	}
 
 	void sendDropItem(Room* room, Creature* actor, Object* target)
 	{
-		/*EventManager.send(EventID::DropItem,room,actor,target,aux);*/
+		sendRoom(EventID::DROP_ITEM, room, actor, target);
 	}
 
 	void sendPickupItem(Room* room, Creature* actor, Object* target)
 	{
-		/*EventManager.send(EventID::PickupItem,room,actor,target,aux);*/
+		sendRoom(EventID::PICKUP_ITEM, room, actor, target);
 	}
 
 } // namespace Events
@@ -6,7 +6,10 @@
  */
 
 #include "common.h"
+#include "lua/core.h"
 #include "lua/exec.h"
+#include "lib/lua51/lua.h"
+#include "lib/lua51/lauxlib.h"
 #include "mud/room.h"
 #include "mud/portal.h"
 #include "mud/object.h"
@@ -14,12 +17,71 @@
 #include "mud/creature.h"
 #include "mud/player.h"
 #include "mud/npc.h"
+#include "mud/hooks.h"
+#include "mud/trace.h"
 
 namespace Hooks {
 
+Slot slots[COUNT];
+
+namespace {
+	const char* names[COUNT] = {
+		"save_creature",
+		"creature_heartbeat",
+		"save_entity",
+		"save_portal",
+		"ready",
+		"change_hour",
+		"save_npc",
+		"npc_death",
+		"npc_heartbeat",
+		"save_object_blueprint",
+		"save_object",
+		"object_heartbeat",
+		"save_player",
+		"player_start",
+		"create_creature",
+		"player_death",
+		"player_heartbeat",
+		"save_room",
+		"room_heartbeat",
+		"show_room",
+		"save_zone",
+		"http_request",
+	};
+}
+
+const char* getName(HookID id)
+{
+	return names[id];
+}
+
+HookID lookup(const std::string& name)
+{
+	for (int i = 0; i < COUNT; ++i)
+		if (name == names[i])
+			return (HookID)i;
+	return COUNT;
+}
+
+void set(HookID id, bool has_budget, uint64 max_instructions, uint64 max_nsecs)
+{
+	if (slots[id].ref != 0)
+		luaL_unref(Lua::state, LUA_REGISTRYINDEX, slots[id].ref);
+	slots[id].ref = luaL_ref(Lua::state, LUA_REGISTRYINDEX);
+	slots[id].has_budget = has_budget;
+	slots[id].max_instructions = max_instructions;
+	slots[id].max_nsecs = max_nsecs;
+	if (slots[id].trace_name == 0)
+		slots[id].trace_name = Trace::intern(names[id]);
+}
+
 bool saveCreature(Creature* self, File::Writer& writer)
 {
-	Lua::ExecHook exec("save_creature");
+	if (!isSet(SAVE_CREATURE))
+		return false;
+
+	Lua::ExecHook exec(SAVE_CREATURE);
 	exec.param(self);
 	Lua::createObject(&writer, "FileWriter");
 	exec.param(&writer);
@@ -30,7 +92,10 @@ bool saveCreature(Creature* self, File::Writer& writer)
 
 bool creatureHeartbeat(Creature* self)
 {
-	Lua::ExecHook exec("creature_heartbeat");
+	if (!isSet(CREATURE_HEARTBEAT))
+		return false;
+
+	Lua::ExecHook exec(CREATURE_HEARTBEAT);
 	exec.param(self);
 	exec.run();
 	return exec.getBoolean();
@@ -38,7 +103,10 @@ bool creatureHeartbeat(Creature* self)
 
 bool saveEntity(Entity* self, File::Writer& writer)
 {
-	Lua::ExecHook exec("save_entity");
+	if (!isSet(SAVE_ENTITY))
+		return false;
+
+	Lua::ExecHook exec(SAVE_ENTITY);
 	exec.param(self);
 	Lua::createObject(&writer, "FileWriter");
 	exec.param(&writer);
@@ -49,7 +117,10 @@ bool saveEntity(Entity* self, File::Writer& writer)
 
 bool savePortal(Portal* self, File::Writer& writer)
 {
-	Lua::ExecHook exec("save_portal");
+	if (!isSet(SAVE_PORTAL))
+		return false;
+
+	Lua::ExecHook exec(SAVE_PORTAL);
 	exec.param(self);
 	Lua::createObject(&writer, "FileWriter");
 	exec.param(&writer);
@@ -60,21 +131,30 @@ bool savePortal(Portal* self, File::Writer& writer)
 
 bool ready()
 {
-	Lua::ExecHook exec("ready");
+	if (!isSet(READY))
+		return false;
+
+	Lua::ExecHook exec(READY);
 	exec.run();
 	return exec.getBoolean();
 }
 
 bool changeHour()
 {
-	Lua::ExecHook exec("change_hour");
+	if (!isSet(CHANGE_HOUR))
+		return false;
+
+	Lua::ExecHook exec(CHANGE_HOUR);
 	exec.run();
 	return exec.getBoolean();
 }
 
 bool saveNpc(Npc* self, File::Writer& writer)
 {
-	Lua::ExecHook exec("save_npc");
+	if (!isSet(SAVE_NPC))
+		return false;
+
+	Lua::ExecHook exec(SAVE_NPC);
 	exec.param(self);
 	Lua::createObject(&writer, "FileWriter");
 	exec.param(&writer);
@@ -85,7 +165,10 @@ bool saveNpc(Npc* self, File::Writer& writer)
 
 bool npcDeath(Npc* self, Creature* killer)
 {
-	Lua::ExecHook exec("npc_death");
+	if (!isSet(NPC_DEATH))
+		return false;
+
+	Lua::ExecHook exec(NPC_DEATH);
 	exec.param(self);
 	exec.param(killer);
 	exec.run();
@@ -94,7 +177,10 @@ bool npcDeath(Npc* self, Creature* killer)
 
 bool npcHeartbeat(Npc* self)
 {
-	Lua::ExecHook exec("npc_heartbeat");
+	if (!isSet(NPC_HEARTBEAT))
+		return false;
+
+	Lua::ExecHook exec(NPC_HEARTBEAT);
 	exec.param(self);
 	exec.run();
 	return exec.getBoolean();
@@ -102,7 +188,10 @@ bool npcHeartbeat(Npc* self)
 
 bool saveObjectBlueprint(ObjectBP* self, File::Writer& writer)
 {
-	Lua::ExecHook exec("save_object_blueprint");
+	if (!isSet(SAVE_OBJECT_BLUEPRINT))
+		return false;
+
+	Lua::ExecHook exec(SAVE_OBJECT_BLUEPRINT);
 	exec.param(self);
 	Lua::createObject(&writer, "FileWriter");
 	exec.param(&writer);
@@ -113,7 +202,10 @@ bool saveObjectBlueprint(ObjectBP* self, File::Writer& writer)
 
 bool saveObject(Object* self, File::Writer& writer)
 {
-	Lua::ExecHook exec("save_object");
+	if (!isSet(SAVE_OBJECT))
+		return false;
+
+	Lua::ExecHook exec(SAVE_OBJECT);
 	exec.param(self);
 	Lua::createObject(&writer, "FileWriter");
 	exec.param(&writer);
@@ -124,7 +216,10 @@ bool saveObject(Object* self, File::Writer& writer)
 
 bool objectHeartbeat(Object* self)
 {
-	Lua::ExecHook exec("object_heartbeat");
+	if (!isSet(OBJECT_HEARTBEAT))
+		return false;
+
+	Lua::ExecHook exec(OBJECT_HEARTBEAT);
 	exec.param(self);
 	exec.run();
 	return exec.getBoolean();
@@ -132,7 +227,10 @@ bool objectHeartbeat(Object* self)
 
 bool savePlayer(Player* self, File::Writer& writer)
 {
-	Lua::ExecHook exec("save_player");
+	if (!isSet(SAVE_PLAYER))
+		return false;
+
+	Lua::ExecHook exec(SAVE_PLAYER);
 	exec.param(self);
 	Lua::createObject(&writer, "FileWriter");
 	exec.param(&writer);
@@ -143,7 +241,10 @@ bool savePlayer(Player* self, File::Writer& writer)
 
 bool playerStart(Player* self)
 {
-	Lua::ExecHook exec("player_start");
+	if (!isSet(PLAYER_START))
+		return false;
+
+	Lua::ExecHook exec(PLAYER_START);
 	exec.param(self);
 	exec.run();
 	return exec.getBoolean();
@@ -151,7 +252,10 @@ bool playerStart(Player* self)
 
 bool createCreature(Player* self)
 {
-	Lua::ExecHook exec("create_creature");
+	if (!isSet(CREATE_CREATURE))
+		return false;
+
+	Lua::ExecHook exec(CREATE_CREATURE);
 	exec.param(self);
 	exec.run();
 	return exec.getBoolean();
@@ -159,7 +263,10 @@ bool createCreature(Player* self)
 
 bool playerDeath(Player* self, Creature* killer)
 {
-	Lua::ExecHook exec("player_death");
+	if (!isSet(PLAYER_DEATH))
+		return false;
+
+	Lua::ExecHook exec(PLAYER_DEATH);
 	exec.param(self);
 	exec.param(killer);
 	exec.run();
@@ -168,7 +275,10 @@ bool playerDeath(Player* self, Creature* killer)
 
 bool playerHeartbeat(Player* self)
 {
-	Lua::ExecHook exec("player_heartbeat");
+	if (!isSet(PLAYER_HEARTBEAT))
+		return false;
+
+	Lua::ExecHook exec(PLAYER_HEARTBEAT);
 	exec.param(self);
 	exec.run();
 	return exec.getBoolean();
@@ -176,7 +286,10 @@ bool playerHeartbeat(Player* self)
 
 bool saveRoom(Room* self, File::Writer& writer)
 {
-	Lua::ExecHook exec("save_room");
+	if (!isSet(SAVE_ROOM))
+		return false;
+
+	Lua::ExecHook exec(SAVE_ROOM);
 	exec.param(self);
 	Lua::createObject(&writer, "FileWriter");
 	exec.param(&writer);
@@ -187,7 +300,10 @@ bool saveRoom(Room* self, File::Writer& writer)
 
 bool roomHeartbeat(Room* self)
 {
-	Lua::ExecHook exec("room_heartbeat");
+	if (!isSet(ROOM_HEARTBEAT))
+		return false;
+
+	Lua::ExecHook exec(ROOM_HEARTBEAT);
 	exec.param(self);
 	exec.run();
 	return exec.getBoolean();
@@ -195,7 +311,10 @@ bool roomHeartbeat(Room* self)
 
 bool showRoom(Room* self, Creature* viewer)
 {
-	Lua::ExecHook exec("show_room");
+	if (!isSet(SHOW_ROOM))
+		return false;
+
+	Lua::ExecHook exec(SHOW_ROOM);
 	exec.param(self);
 	exec.param(viewer);
 	exec.run();
@@ -204,7 +323,10 @@ bool showRoom(Room* self, Creature* viewer)
 
 bool saveZone(Zone* self, File::Writer& writer)
 {
-	Lua::ExecHook exec("save_zone");
+	if (!isSet(SAVE_ZONE))
+		return false;
+
+	Lua::ExecHook exec(SAVE_ZONE);
 	exec.param(self);
 	Lua::createObject(&writer, "FileWriter");
 	exec.param(&writer);
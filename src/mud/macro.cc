@@ -9,12 +9,18 @@
 #include "common/streams.h"
 #include "common/strbuf.h"
 #include "common/string.h"
+#include "common/log.h"
+#include "common/file.h"
 #include "mud/macro.h"
+#include "mud/fileobj.h"
+#include "mud/message.h"
+#include "mud/settings.h"
 #include "mud/gametime.h"
 #include "mud/player.h"
 #include "net/manager.h"
 #include "lua/core.h"
 #include "lua/print.h"
+#include "lua/bytecode.h"
 #include "lib/lua51/lua.h"
 #include "lib/lua51/lauxlib.h"
 
@@ -29,25 +35,12 @@ class MacroParseException {
 	const char* msg;
 };
 
-// macro value
-class MacroCompiler {
-public:
-	MacroCompiler(const char *_source, size_t _source_len) : source(_source),
+// macro tokenizer, shared by the compilers
+class MacroLexer {
+protected:
+	MacroLexer(const char *_source, size_t _source_len) : source(_source),
 			sptr(source), source_len(_source_len), next_token(TOK_NONE) {}
 
-	// macro text
-	bool compile(std::ostream& stream) {
-		try {
-			parseBody(stream, true);
-			return true;
-		} catch (MacroParseException& e) {
-			stream << "print(\"[[error: " << e.msg << "]]\")\n";
-			return false;
-		}
-	}
-
-private:
-	// if statements
 	enum token_type {
 		TOK_NONE, TOK_ERROR, TOK_NAME, TOK_STRING, TOK_TRUE, TOK_FALSE,
 		TOK_NUMBER, TOK_BEGIN, TOK_END, TOK_IF, TOK_ELIF, TOK_ELSE, TOK_ENDIF,
@@ -66,27 +59,6 @@ private:
 	char peekc() const { if (sptr == source + source_len) return 0; else return *sptr; }
 	bool eof() const { return sptr == source + source_len; }
 
-	// format a Lua string safely
-	void printString(std::ostream& stream, const char *string, size_t len) {
-		stream << '\'';
-		for (size_t i = 0; i != len; ++i) {
-			if (string[i] == '\\')
-				stream << "\\\\";
-			else if (string[i] == '\'')
-				stream << "\\'";
-			else if (string[i] == '\n')
-				stream << "\\n";
-			else if (isprint(string[i]))
-				stream << string[i];
-			else {
-				char buf[5];
-				snprintf(buf, sizeof(buf), "\\%03d", (int)string[i]);
-				stream << buf;
-			}
-		}
-		stream << '\'';
-	}
-
 	// getc a token
 	token_type getToken() {
 		// skip whitespace
@@ -215,6 +187,54 @@ private:
 		else
 			throw MacroParseException("did not get expected token type");
 	}
+};
+
+// compiles a macro to a Lua chunk
+class MacroCompiler : private MacroLexer {
+public:
+	MacroCompiler(const char *_source, size_t _source_len) : MacroLexer(_source, _source_len) {}
+
+	// macro text; the chunk takes the argument table, and writes its
+	// output with macro.put()
+	bool compile(std::ostream& stream) {
+		stream << "local argv = ...\nlocal put, property = macro.put, macro.property\n";
+		try {
+			parseBody(stream, true);
+			return true;
+		} catch (MacroParseException& e) {
+			stream << "put(\"[[error: " << e.msg << "]]\")\n";
+			return false;
+		}
+	}
+
+private:
+	// format a Lua string safely
+	void printString(std::ostream& stream, const char *string, size_t len) {
+		stream << '\'';
+		for (size_t i = 0; i != len; ++i) {
+			if (string[i] == '\\')
+				stream << "\\\\";
+			else if (string[i] == '\'')
+				stream << "\\'";
+			else if (string[i] == '\n')
+				stream << "\\n";
+			else if (isprint(string[i]))
+				stream << string[i];
+			else {
+				char buf[5];
+				snprintf(buf, sizeof(buf), "\\%03d", (int)string[i]);
+				stream << buf;
+			}
+		}
+		stream << '\'';
+	}
+
+	// look up a $variable in the argument table
+	void printArgument(std::ostream& stream, const std::string& var) {
+		stream << "argv[";
+		printString(stream, var.c_str() + 1, var.size() - 1);
+		stream << ']';
+	}
 
 	bool acceptBinaryOp(std::ostream& stream) {
 		// == operator
@@ -245,7 +265,7 @@ private:
 	bool acceptTerminal(std::ostream& stream) {
 		// variable
 		if (accept(TOK_VAR)) {
-			stream << "macro.lookup('" << token_value << "')";
+			printArgument(stream, token_value);
 			return true;
 
 		// boolean literals
@@ -300,16 +320,14 @@ private:
 			std::string var = token_value;
 			if (accept(TOK_PROPERTY)) {
 				expect(TOK_NAME);
-				stream << "macro.property(";
-				printString(stream, var.c_str(), var.size());
+				stream << "property(";
+				printArgument(stream, var);
 				stream << ',';
 				printString(stream, token_value.c_str(), token_value.size());
 				parseArguments(stream);
 				stream << ')';
 			} else {
-				stream << "macro.lookup(";
-				printString(stream, var.c_str(), var.size());
-				stream << ')';
+				printArgument(stream, var);
 			}
 			return true;
 
@@ -371,7 +389,7 @@ private:
 			if (*sptr == '{') {
 				// spit out string so far
 				if (sptr != lptr) {
-					stream << "print(";
+					stream << "put(";
 					printString(stream, lptr, sptr - lptr);
 					stream << ")\n";
 				}
@@ -384,9 +402,9 @@ private:
 					throw MacroParseException("unexpected end of string after {");
 
 				// if it's another {, it's an escape; set it as the next printable
-				// character and continue
+				// character and continue past it
 				if (*sptr == '{') {
-					lptr = sptr;
+					lptr = sptr++;
 					continue;
 				}
 
@@ -439,7 +457,7 @@ private:
 
 					// expression
 					} else {
-						stream << "print(";
+						stream << "put(";
 						if (!acceptExpr(stream))
 							throw MacroParseException("expected expression");
 						expect(TOK_END);
@@ -449,7 +467,7 @@ private:
 				} catch (MacroParseException& e) {
 					// print if in top of body
 					if (top)
-						stream << "print(\"[[error: " << StreamChunk(lptr, sptr - lptr) << ": " << e.msg << "]]\")\n";
+						stream << "put(\"[[error: " << StreamChunk(lptr, sptr - lptr) << ": " << e.msg << "]]\")\n";
 					else
 						throw e;
 				}
@@ -462,7 +480,7 @@ private:
 
 		// spit out remaining bit of string
 		if (sptr != lptr) {
-			stream << "print(";
+			stream << "put(";
 			printString(stream, lptr, sptr - lptr);
 			stream << ")\n";
 		}
@@ -473,50 +491,620 @@ private:
 	}
 };
 
+// compact form for the common macros: literal text, arguments, their
+// properties, ^ and if/elif/else on simple tests.  rendering writes
+// straight to the stream, with no Lua involved; anything else is left
+// to the Lua compiler
+struct NativeMacro {
+	enum Code { TEXT, VALUE, PROPERTY, BRANCH, JUMP };
+	enum Flag { RAISE = 1, NOT = 2, EQ = 4, NE = 8 };
+	static const uint32 NONE = 0xFFFFFFFF;
+
+	// an argument, by name, or a literal
+	struct Operand {
+		enum Kind { ARGUMENT, STRING, NUMBER, BOOLEAN } kind;
+		std::string text;
+		double number;
+	};
+
+	struct Op {
+		uint8 code;
+		uint8 flags;
+		uint32 a; // TEXT: offset in text; others: operand
+		uint32 b; // TEXT: length; PROPERTY: name operand; BRANCH: right operand or NONE
+		uint32 target; // BRANCH (taken when the test fails), JUMP
+	};
+
+	std::string text; // the literal runs, back to back
+	std::vector<Operand> operands;
+	std::vector<Op> ops;
+
+	void render(const StreamControl& stream, const MacroArgs& argv) const;
+
+private:
+	// an operand's value for one rendering
+	struct Value {
+		enum Type { NIL, BOOLEAN, NUMBER, STRING, OBJECT } type;
+		double number; // also 0/1 for booleans
+		const std::string* string;
+		const IMacroObject* object;
+	};
+
+	Value resolve(uint32 operand, const MacroArgs& argv) const;
+	bool test(const Op& op, const MacroArgs& argv) const;
+	static void put(const StreamControl& stream, const Value& value, bool raise);
+	static void putRaised(const StreamControl& stream, const char* text, size_t len);
+};
+
+NativeMacro::Value NativeMacro::resolve(uint32 operand, const MacroArgs& argv) const
+{
+	const Operand& op = operands[operand];
+	Value value = { Value::NIL, 0.0, NULL, NULL };
+	switch (op.kind) {
+		case Operand::ARGUMENT: {
+			MacroArgs::const_iterator i = argv.find(op.text);
+			if (i == argv.end() || i->second.isNull())
+				break;
+			if (i->second.isString()) {
+				value.type = Value::STRING;
+				value.string = &i->second.getString();
+			} else {
+				value.type = Value::OBJECT;
+				value.object = i->second.getObject();
+			}
+			break;
+		}
+		case Operand::STRING:
+			value.type = Value::STRING;
+			value.string = &op.text;
+			break;
+		case Operand::NUMBER:
+			value.type = Value::NUMBER;
+			value.number = op.number;
+			break;
+		case Operand::BOOLEAN:
+			value.type = Value::BOOLEAN;
+			value.number = op.number;
+			break;
+	}
+	return value;
+}
+
+// Lua's rules: only nil and false are false, and values of different
+// types are never equal
+bool NativeMacro::test(const Op& op, const MacroArgs& argv) const
+{
+	Value left = resolve(op.a, argv);
+	if (op.b == NONE) {
+		bool truth = left.type != Value::NIL && (left.type != Value::BOOLEAN || left.number != 0.0);
+		return (op.flags & NOT) ? !truth : truth;
+	}
+
+	Value right = resolve(op.b, argv);
+	bool equal = left.type == right.type;
+	if (equal) {
+		switch (left.type) {
+			case Value::NIL: break;
+			case Value::BOOLEAN:
+			case Value::NUMBER: equal = left.number == right.number; break;
+			case Value::STRING: equal = *left.string == *right.string; break;
+			case Value::OBJECT: equal = left.object == right.object; break;
+		}
+	}
+	return (op.flags & EQ) ? equal : !equal;
+}
+
+void NativeMacro::putRaised(const StreamControl& stream, const char* text, size_t len)
+{
+	if (len == 0)
+		return;
+	char first = toupper(text[0]);
+	stream.streamPut(&first, 1);
+	stream.streamPut(text + 1, len - 1);
+}
+
+// as macro.put() and macro.raise() would
+void NativeMacro::put(const StreamControl& stream, const Value& value, bool raise)
+{
+	switch (value.type) {
+		case Value::STRING:
+			if (raise)
+				putRaised(stream, value.string->data(), value.string->size());
+			else
+				stream.streamPut(value.string->data(), value.string->size());
+			break;
+		case Value::NUMBER: {
+			char buffer[32];
+			int len = snprintf(buffer, sizeof(buffer), LUA_NUMBER_FMT, value.number);
+			stream.streamPut(buffer, len);
+			break;
+		}
+		case Value::OBJECT:
+			if (raise) {
+				StringBuffer buffer;
+				value.object->macroDefault(StreamControl(buffer));
+				putRaised(stream, buffer.c_str(), buffer.size());
+			} else {
+				value.object->macroDefault(stream);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+void NativeMacro::render(const StreamControl& stream, const MacroArgs& argv) const
+{
+	static const MacroList no_args;
+
+	size_t pc = 0;
+	while (pc < ops.size()) {
+		const Op& op = ops[pc++];
+		switch (op.code) {
+			case TEXT:
+				stream.streamPut(text.data() + op.a, op.b);
+				break;
+			case VALUE:
+				put(stream, resolve(op.a, argv), op.flags & RAISE);
+				break;
+			case PROPERTY: {
+				Value self = resolve(op.a, argv);
+				if (self.type != Value::OBJECT)
+					break;
+				const std::string& name = operands[op.b].text;
+				if (op.flags & RAISE) {
+					StringBuffer buffer;
+					if (self.object->macroProperty(StreamControl(buffer), name, no_args) != 0)
+						stream << "[[unknown property '" << name << "']]";
+					else
+						putRaised(stream, buffer.c_str(), buffer.size());
+				} else if (self.object->macroProperty(stream, name, no_args) != 0) {
+					stream << "[[unknown property '" << name << "']]";
+				}
+				break;
+			}
+			case BRANCH:
+				if (!test(op, argv))
+					pc = op.target;
+				break;
+			case JUMP:
+				pc = op.target;
+				break;
+		}
+	}
+}
+
+// compiles a macro to a NativeMacro, if it only uses what that
+// supports; the grammar is the Lua compiler's, cut down
+class NativeCompiler : private MacroLexer {
+public:
+	NativeCompiler(const char *_source, size_t _source_len) : MacroLexer(_source, _source_len), program(NULL) {}
+
+	// false if the macro needs Lua, or has errors for the Lua
+	// compiler to report
+	bool compile(NativeMacro& out) {
+		program = &out;
+		try {
+			parseBody(true);
+			return true;
+		} catch (MacroParseException&) {
+			return false;
+		}
+	}
+
+private:
+	NativeMacro* program;
+
+	uint32 emit(uint8 code, uint8 flags = 0, uint32 a = 0, uint32 b = 0) {
+		NativeMacro::Op op = { code, flags, a, b, NativeMacro::NONE };
+		program->ops.push_back(op);
+		return program->ops.size() - 1;
+	}
+
+	void emitText(const char* text, size_t len) {
+		if (len == 0)
+			return;
+		emit(NativeMacro::TEXT, 0, program->text.size(), len);
+		program->text.append(text, len);
+	}
+
+	// point a BRANCH or JUMP at the next op
+	void land(uint32 op) {
+		program->ops[op].target = program->ops.size();
+	}
+
+	uint32 addOperand(NativeMacro::Operand::Kind kind, const std::string& text, double number = 0.0) {
+		NativeMacro::Operand operand;
+		operand.kind = kind;
+		operand.text = text;
+		operand.number = number;
+		program->operands.push_back(operand);
+		return program->operands.size() - 1;
+	}
+
+	// an argument without properties, or a literal
+	uint32 parseOperand() {
+		if (accept(TOK_VAR)) {
+			// peeking reads the next token over token_value
+			std::string var = token_value.substr(1);
+			if (peek(TOK_PROPERTY))
+				throw MacroParseException("property in a test");
+			return addOperand(NativeMacro::Operand::ARGUMENT, var);
+		} else if (accept(TOK_STRING)) {
+			return addOperand(NativeMacro::Operand::STRING, token_value);
+		} else if (accept(TOK_NUMBER)) {
+			return addOperand(NativeMacro::Operand::NUMBER, token_value, atof(token_value.c_str()));
+		} else if (accept(TOK_TRUE)) {
+			return addOperand(NativeMacro::Operand::BOOLEAN, token_value, 1.0);
+		} else if (accept(TOK_FALSE)) {
+			return addOperand(NativeMacro::Operand::BOOLEAN, token_value, 0.0);
+		}
+		throw MacroParseException("not a simple operand");
+	}
+
+	// [not] operand, or operand eq|ne operand; emits the BRANCH
+	uint32 parseTest() {
+		if (accept(TOK_NOT)) {
+			uint32 operand = parseOperand();
+			expect(TOK_END);
+			return emit(NativeMacro::BRANCH, NativeMacro::NOT, operand, NativeMacro::NONE);
+		}
+
+		uint32 left = parseOperand();
+		uint8 flags = 0;
+		uint32 right = NativeMacro::NONE;
+		if (accept(TOK_EQ))
+			flags = NativeMacro::EQ;
+		else if (accept(TOK_NE))
+			flags = NativeMacro::NE;
+		if (flags != 0)
+			right = parseOperand();
+		expect(TOK_END);
+		return emit(NativeMacro::BRANCH, flags, left, right);
+	}
+
+	// [^] operand, or [^] $var.property
+	void parseValue() {
+		uint8 flags = accept(TOK_RAISE) ? NativeMacro::RAISE : 0;
+		if (accept(TOK_VAR)) {
+			std::string var = token_value.substr(1);
+			if (accept(TOK_PROPERTY)) {
+				expect(TOK_NAME);
+				if (peek(TOK_LPAREN))
+					throw MacroParseException("property arguments");
+				uint32 self = addOperand(NativeMacro::Operand::ARGUMENT, var);
+				emit(NativeMacro::PROPERTY, flags, self, addOperand(NativeMacro::Operand::STRING, token_value));
+			} else {
+				emit(NativeMacro::VALUE, flags, addOperand(NativeMacro::Operand::ARGUMENT, var));
+			}
+		} else {
+			emit(NativeMacro::VALUE, flags, parseOperand());
+		}
+		expect(TOK_END);
+	}
+
+	void parseBody(bool top) {
+		const char *lptr = sptr;
+		while (!eof()) {
+			if (*sptr != '{') {
+				++sptr;
+				continue;
+			}
+
+			emitText(lptr, sptr - lptr);
+			lptr = ++sptr;
+			if (eof())
+				throw MacroParseException("unexpected end of string after {");
+
+			// {{ is an escaped {
+			if (*sptr == '{') {
+				lptr = sptr++;
+				continue;
+			}
+
+			next_token = TOK_NONE;
+			if (accept(TOK_IF)) {
+				// each failed test jumps to the next; each body that
+				// ran jumps to the end
+				std::vector<uint32> ends;
+				uint32 branch = parseTest();
+				parseBody(false);
+				while (accept(TOK_ELIF)) {
+					ends.push_back(emit(NativeMacro::JUMP));
+					land(branch);
+					branch = parseTest();
+					parseBody(false);
+				}
+				if (accept(TOK_ELSE)) {
+					expect(TOK_END);
+					ends.push_back(emit(NativeMacro::JUMP));
+					land(branch);
+					branch = NativeMacro::NONE;
+					parseBody(false);
+				}
+				expect(TOK_ENDIF);
+				expect(TOK_END);
+
+				if (branch != NativeMacro::NONE)
+					land(branch);
+				for (std::vector<uint32>::const_iterator i = ends.begin(); i != ends.end(); ++i)
+					land(*i);
+
+			// return to parent on else/elseif/endif
+			} else if (peek(TOK_ELSE) || peek(TOK_ELIF) || peek(TOK_ENDIF)) {
+				if (top)
+					throw MacroParseException("else/elif/endif outside of if");
+				return;
+
+			} else {
+				parseValue();
+			}
+
+			lptr = sptr;
+		}
+
+		emitText(lptr, sptr - lptr);
+		if (!top)
+			throw MacroParseException("unexpected end of string inside if block");
+	}
+};
+
+namespace {
+	// compiled macros, keyed by a hash of their text; the text is kept
+	// to tell collisions apart.  lru holds the keys, most recently used
+	// first, and the least recently used are dropped past the
+	// macro_cache setting
+	typedef std::list<uint64> LruList;
+	struct CacheEntry {
+		std::string text;
+		std::tr1::shared_ptr<const NativeMacro> native; // if it has a native form
+		int ref; // otherwise the function, in the Lua registry
+		LruList::iterator lru;
+	};
+	typedef std::tr1::unordered_map<uint64, CacheEntry> CacheMap;
+
+	CacheMap cache;
+	LruList lru;
+	uint64 hits = 0;
+	uint64 misses = 0;
+	uint64 evictions = 0;
+	size_t native_count = 0;
+
+	// stream the running macro writes to; NULL outside of macro::text()
+	const StreamControl* current = NULL;
+
+	// 64-bit FNV-1a
+	uint64 hashText(const std::string& text) {
+		uint64 hash = 14695981039346656037ULL;
+		for (std::string::const_iterator i = text.begin(); i != text.end(); ++i) {
+			hash ^= (unsigned char)*i;
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	void drop(CacheMap::iterator i) {
+		if (i->second.native)
+			--native_count;
+		else
+			luaL_unref(Lua::state, LUA_REGISTRYINDEX, i->second.ref);
+		lru.erase(i->second.lru);
+		cache.erase(i);
+	}
+
+	// objects reach scripts as MacroObject userdata holding the
+	// pointer; text() clears them when the macro returns, so one a
+	// script holds on to can't outlive the object
+	const IMacroObject** pushObject(const IMacroObject* object) {
+		const IMacroObject** box = (const IMacroObject**)lua_newuserdata(Lua::state, sizeof(const IMacroObject*));
+		*box = object;
+		luaL_getmetatable(Lua::state, "MacroObject");
+		lua_setmetatable(Lua::state, -2);
+		return box;
+	}
+
+	// the object in the MacroObject at index i; NULL if there is no
+	// MacroObject there, an error if its macro has returned
+	const IMacroObject* toObject(lua_State* s, int i) {
+		const IMacroObject** box = (const IMacroObject**)lua_touserdata(s, i);
+		if (box == NULL || !lua_getmetatable(s, i))
+			return NULL;
+		luaL_getmetatable(s, "MacroObject");
+		bool match = lua_rawequal(s, -1, -2);
+		lua_pop(s, 2);
+		if (!match)
+			return NULL;
+		if (*box == NULL)
+			luaL_error(s, "macro object used after its macro returned");
+		return *box;
+	}
+}
+
 // parsing
 namespace macro {
-	// macro text
-	bool text(const StreamControl& stream, const std::string& in, const MacroArgs& argv) {
-		// look up the macro cache
-		lua_getfield(Lua::state, LUA_REGISTRYINDEX, "macro-cache");
-		if (!lua_istable(Lua::state, -1)) {
+	// push the compiled function for a macro text, from the bytecode
+	// cache if it's there; on error, pushes nothing
+	bool compile(const std::string& in) {
+		std::string key = "macro 3\n" + in;
+		if (Lua::Bytecode::load(key))
+			return true;
+
+		// create compiler
+		MacroCompiler mc(in.c_str(), in.size());
+
+		// compile macro
+		std::ostringstream source;
+		mc.compile(source);
+
+		// compile Lua script
+		int rs = luaL_loadstring(Lua::state, source.str().c_str());
+		if (rs != 0) {
+			Log::Error << "Couldn't compile script: " << lua_tostring(Lua::state, -1);
 			lua_pop(Lua::state, 1);
-			lua_newtable(Lua::state);
-			lua_pushvalue(Lua::state, -1);
-			lua_setfield(Lua::state, LUA_REGISTRYINDEX, "macro-cache");
+			return false;
 		}
 
-		// look up the macro in the macro cache
-		lua_getfield(Lua::state, -1, in.c_str());
-		if (!lua_isfunction(Lua::state, -1)) {
-			lua_pop(Lua::state, 1);
+		Lua::Bytecode::store(key);
+		return true;
+	}
 
-			// create compiler
-			MacroCompiler mc(in.c_str(), in.size());
+	// find or compile a macro text; NULL on error.  the entry is only
+	// good until the next load()
+	const CacheEntry* load(const std::string& in) {
+		uint64 hash = hashText(in);
+		CacheMap::iterator i = cache.find(hash);
+		if (i != cache.end() && i->second.text == in) {
+			++hits;
+			lru.splice(lru.begin(), lru, i->second.lru);
+			return &i->second;
+		}
 
-			// compile macro
-			std::ostringstream source;
-			mc.compile(source);
-			Log::Info << "SCRIPT:\n" << source.str();
+		// only go to Lua for what the native form can't do; that
+		// pushes the function
+		++misses;
+		std::tr1::shared_ptr<NativeMacro> native(new NativeMacro());
+		if (!NativeCompiler(in.c_str(), in.size()).compile(*native)) {
+			native.reset();
+			if (!compile(in))
+				return NULL;
+		}
 
-			// compile Lua script
-			int rs = luaL_loadstring(Lua::state, source.str().c_str());
-			if (rs != 0) {
-				Log::Error << "Couldn't compile script: " << lua_tostring(Lua::state, -1);
-				lua_pop(Lua::state, 2);
-				return false;
+		// a different text with the same hash is replaced
+		if (i != cache.end())
+			drop(i);
+		size_t limit = MSettings.getMacroCache() > 0 ? MSettings.getMacroCache() : 1;
+		while (cache.size() >= limit) {
+			drop(cache.find(lru.back()));
+			++evictions;
+		}
+
+		lru.push_front(hash);
+		CacheEntry& entry = cache[hash];
+		entry.text = in;
+		entry.native = native;
+		entry.ref = native ? LUA_NOREF : luaL_ref(Lua::state, LUA_REGISTRYINDEX);
+		entry.lru = lru.begin();
+		if (native)
+			++native_count;
+		return &entry;
+	}
+
+	// true if a macro text has a native form, and so no Lua
+	bool isNative(const std::string& in) {
+		NativeMacro native;
+		return NativeCompiler(in.c_str(), in.size()).compile(native);
+	}
+
+	int precompile() {
+		int count = 0;
+
+		// messages
+		const _MMessage::MessageMap& messages = MMessage.getMessages();
+		for (_MMessage::MessageMap::const_iterator i = messages.begin(); i != messages.end(); ++i) {
+			if (!isNative(i->second) && compile(i->second)) {
+				lua_pop(Lua::state, 1);
+				++count;
 			}
+		}
 
-			// store in cache
-			lua_pushvalue(Lua::state, -1);
-			lua_setfield(Lua::state, -3, in.c_str());
-			lua_remove(Lua::state, -2);
+		// descriptions and anything else with a macro in it, in the
+		// zone and blueprint files
+		std::vector<std::string> files = File::dirlist(MSettings.getZonePath());
+		File::filter(files, "*.zone");
+		std::vector<std::string> blueprints = File::dirlist(MSettings.getBlueprintPath());
+		File::filter(blueprints, "*.npcs");
+		files.insert(files.end(), blueprints.begin(), blueprints.end());
+		blueprints = File::dirlist(MSettings.getBlueprintPath());
+		File::filter(blueprints, "*.objs");
+		files.insert(files.end(), blueprints.begin(), blueprints.end());
+
+		for (std::vector<std::string>::const_iterator i = files.begin(); i != files.end(); ++i) {
+			File::Reader reader;
+			if (reader.open(*i))
+				continue;
+
+			try {
+				File::Node node(reader);
+				while (reader.get(node)) {
+					if (!node.isAttr() || node.getValueType() != File::Value::TYPE_STRING)
+						continue;
+					std::string text = node.getString();
+					if (node.getName() != "desc" && text.find('{') == std::string::npos)
+						continue;
+					if (!isNative(text) && compile(text)) {
+						lua_pop(Lua::state, 1);
+						++count;
+					}
+				}
+			} catch (File::Error& error) {
+				Log::Error << error.getWhat();
+			}
 		}
 
-		// execute the script
-		Lua::setPrint(new StreamWrap(stream));
-		int rs = lua_pcall(Lua::state, 0, 0, 0);
-		Lua::setPrint(NULL);
+		return count;
+	}
+
+	// macro text
+	bool text(const StreamControl& stream, const std::string& in, const MacroArgs& argv) {
+		const CacheEntry* entry = load(in);
+		if (entry == NULL)
+			return false;
+
+		// the native form writes straight to the stream; hold on to
+		// it, as a nested macro may evict the entry
+		if (entry->native) {
+			std::tr1::shared_ptr<const NativeMacro> native = entry->native;
+			native->render(stream, argv);
+			return true;
+		}
+		lua_rawgeti(Lua::state, LUA_REGISTRYINDEX, entry->ref);
+
+		// the argument table.  objects are also kept in an anchor
+		// table, so they can't be collected before we clear them, and
+		// an object passed twice is the same userdata, so == holds
+		std::vector<const IMacroObject**> boxes;
+		int anchor = LUA_NOREF;
+		lua_createtable(Lua::state, 0, argv.size());
+		for (MacroArgs::const_iterator i = argv.begin(); i != argv.end(); ++i) {
+			if (i->second.isString()) {
+				lua_pushlstring(Lua::state, i->second.getString().data(), i->second.getString().size());
+			} else if (i->second.isObject()) {
+				if (anchor == LUA_NOREF) {
+					lua_newtable(Lua::state);
+					anchor = luaL_ref(Lua::state, LUA_REGISTRYINDEX);
+				}
+				size_t index = 0;
+				while (index < boxes.size() && *boxes[index] != i->second.getObject())
+					++index;
+				lua_rawgeti(Lua::state, LUA_REGISTRYINDEX, anchor);
+				if (index < boxes.size()) {
+					lua_rawgeti(Lua::state, -1, index + 1);
+				} else {
+					boxes.push_back(pushObject(i->second.getObject()));
+					lua_pushvalue(Lua::state, -1);
+					lua_rawseti(Lua::state, -3, boxes.size());
+				}
+				lua_remove(Lua::state, -2);
+			} else {
+				continue;
+			}
+			lua_setfield(Lua::state, -2, i->first.c_str());
+		}
+
+		// execute the script; macros may nest through properties, so
+		// put back whatever stream was in use
+		const StreamControl* old_stream = current;
+		IStreamSink* old_sink = Lua::getPrint();
+		StreamWrap sink(stream);
+		current = &stream;
+		Lua::setPrint(&sink);
+		int rs = Lua::pcall(1, 0);
+		Lua::setPrint(old_sink);
+		current = old_stream;
+
+		for (std::vector<const IMacroObject**>::iterator i = boxes.begin(); i != boxes.end(); ++i)
+			**i = NULL;
+		luaL_unref(Lua::state, LUA_REGISTRYINDEX, anchor);
 		if (rs != 0) {
 			Log::Error << "Couldn't execute script: " << lua_tostring(Lua::state, -1);
 			lua_pop(Lua::state, 1);
@@ -526,6 +1114,26 @@ namespace macro {
 		return true;
 	}
 
+	size_t getCacheSize() {
+		return cache.size();
+	}
+
+	size_t getCacheNative() {
+		return native_count;
+	}
+
+	uint64 getCacheHits() {
+		return hits;
+	}
+
+	uint64 getCacheMisses() {
+		return misses;
+	}
+
+	uint64 getCacheEvictions() {
+		return evictions;
+	}
+
 	int execMacro(const StreamControl& stream, const std::string& command, MacroList& argv) {
 		// FIXME: implement these in scripts/macro.lua
 		if (strEq(command, "uptime")) {
@@ -587,3 +1195,124 @@ namespace macro {
 		return 0;
 	}
 }
+
+// -------------------
+//   BINDINGS
+// -------------------
+namespace {
+namespace bindings {
+
+// -------------------
+//   MACRO.*
+// -------------------
+namespace macro {
+
+int put(lua_State*);
+int property(lua_State*);
+int defaultText(lua_State*);
+const luaL_Reg registry[] = {
+	{ "put", put },
+	{ "property", property },
+	{ "default", defaultText },
+	{ NULL, NULL }
+};
+
+/**
+ * name: macro.put
+ * param: ... values to write to the macro's output; objects write
+ *        their default text, nil and booleans nothing
+ */
+int put(lua_State* s)
+{
+	if (current == NULL)
+		return luaL_error(s, "macro.put called outside of a macro");
+
+	for (int i = 1, e = lua_gettop(s); i <= e; ++i) {
+		if (const IMacroObject* object = toObject(s, i)) {
+			object->macroDefault(*current);
+		} else if (lua_isstring(s, i)) {
+			size_t len;
+			const char* str = lua_tolstring(s, i, &len);
+			current->streamPut(str, len);
+		}
+	}
+	return 0;
+}
+
+/**
+ * name: macro.property
+ * param: object the macro argument
+ * param: string property name
+ * param: ... arguments to the property
+ * return: string the property's text; nil if object isn't an object
+ */
+int property(lua_State* s)
+{
+	const IMacroObject* object = toObject(s, 1);
+	if (object == NULL) {
+		lua_pushnil(s);
+		return 1;
+	}
+	const char* name = luaL_checkstring(s, 2);
+
+	MacroList argv;
+	for (int i = 3, e = lua_gettop(s); i <= e; ++i) {
+		if (const IMacroObject* arg = toObject(s, i))
+			argv.push_back(MacroValue(arg));
+		else if (lua_isstring(s, i))
+			argv.push_back(MacroValue(std::string(lua_tostring(s, i))));
+		else
+			argv.push_back(MacroValue());
+	}
+
+	StringBuffer buffer;
+	if (object->macroProperty(StreamControl(buffer), name, argv) != 0)
+		lua_pushfstring(s, "[[unknown property '%s']]", name);
+	else
+		lua_pushstring(s, buffer.c_str());
+	return 1;
+}
+
+/**
+ * name: macro.default
+ * param: object the macro argument
+ * return: string the object's default text; nil if object isn't an
+ *         object
+ */
+int defaultText(lua_State* s)
+{
+	const IMacroObject* object = toObject(s, 1);
+	if (object == NULL) {
+		lua_pushnil(s);
+		return 1;
+	}
+
+	StringBuffer buffer;
+	object->macroDefault(StreamControl(buffer));
+	lua_pushstring(s, buffer.c_str());
+	return 1;
+}
+
+} // namespace bindings::macro
+
+// -------------------
+//   END BINDINGS
+// -------------------
+
+} // namespace bindings
+} // anonymous
+
+namespace Lua {
+	bool initializeMacrolib()
+	{
+		// objects passed to macros; see pushObject()
+		luaL_newmetatable(Lua::state, "MacroObject");
+		lua_pop(Lua::state, 1);
+
+		// scripts/macro.lua adds the rest of the table
+		luaL_register(Lua::state, "macro", bindings::macro::registry);
+		lua_pop(Lua::state, 1);
+
+		return true;
+	}
+} // namespace Lua
@@ -14,6 +14,7 @@
 #include "common/fdprintf.h"
 #include "common/file.h"
 #include "mud/player.h"
+#include "mud/cstore.h"
 #include "mud/settings.h"
 #include "mud/weather.h"
 #include "mud/zone.h"
@@ -25,6 +26,8 @@
 #include "mud/server.h"
 #include "mud/settings.h"
 #include "mud/login.h"
+#include "mud/trace.h"
+#include "mud/scheduler.h"
 #include "net/manager.h"
 #include "net/telnet.h"
 #include "net/http.h"
@@ -68,6 +71,7 @@ namespace
 	// Signal flags
 	volatile bool signaled_shutdown = false;
 	volatile bool signaled_reload = false;
+	volatile bool signaled_trace = false;
 }
 
 // FUNCTIONS
@@ -95,6 +99,13 @@ namespace
 		signaled_reload = true;
 	}
 
+	// user signal 1 handler; dumps the trace
+	void
+	sigusr1Handler(int)
+	{
+		signaled_trace = true;
+	}
+
 	// write out our pid file
 	int
 	writePidFile(const std::string& path)
@@ -493,6 +504,12 @@ int main(int argc, char **argv)
 		Log::Error << "sigaction() failed (SIGHUP)";
 		return 1;
 	}
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = sigusr1Handler;
+	if (sigaction(SIGUSR1, &sa, NULL)) {
+		Log::Error << "sigaction() failed (SIGUSR1)";
+		return 1;
+	}
 
 	Random::init();  // random info
 
@@ -504,6 +521,15 @@ int main(int argc, char **argv)
 	if (!Lua::initialize())
 		return 1;
 
+	// just fill the bytecode cache?
+	if (MSettings.getPrecompile()) {
+		int count = macro::precompile();
+		Log::Info << "Precompiled " << count << " macros";
+		IManager::shutdownAll();
+		Lua::shutdown();
+		return 0;
+	}
+
 	// load the world
 	if (MZone.loadWorld())
 		return 1;
@@ -579,6 +605,7 @@ int main(int argc, char **argv)
 	gettimeofday(&nexttick, NULL);
 	timevalAddMs(nexttick, 1000 / TICKS_PER_ROUND);
 	ulong last_autosave = 0;
+	time_t last_trace_dump = 0;
 	ulong cur_ticks = 0;
 	game_ticks = 0;
 
@@ -618,10 +645,17 @@ int main(int argc, char **argv)
 		// behind on ticks?
 		else if (cur_ticks > game_ticks)
 			timeout = 0;
-		// have players?  need a timeout for game updates
-		else if (MPlayer.count())
+		// have players or scripts?  need a timeout for game updates
+		else if (MPlayer.count() || MScheduler.getThreadCount())
 			timeout = msUntilTimeval(nexttick);
 
+		// collect Lua garbage with some of the time we'd sleep, so it
+		// doesn't land in the middle of a tick
+		if (timeout > 1 && MSettings.getLuaGcIdle() > 0) {
+			long budget = timeout / 2 < MSettings.getLuaGcIdle() ? timeout / 2 : MSettings.getLuaGcIdle();
+			timeout -= Lua::collectIdle((uint64)budget * 1000000) / 1000000;
+		}
+
 		// do select - no player, don't timeout
 		MNetwork.poll(timeout);
 
@@ -629,8 +663,11 @@ int main(int argc, char **argv)
 		// update timer
 		struct timeval current;
 		gettimeofday(&current, NULL);
+		uint64 tick_start = 0;
 		if (timercmp(&current, &nexttick, >=)) {
 			++game_ticks;
+			tick_start = Time::nsecs();
+			Trace::record(Trace::TICK, 0, game_ticks);
 
 			// time of next tick
 			timevalAddMs(nexttick, 1000 / TICKS_PER_ROUND);
@@ -639,6 +676,10 @@ int main(int argc, char **argv)
 
 			// update entities
 			MEntity.heartbeat();
+			MCreatureStore.heartbeat();
+
+			// resume sleeping scripts
+			MScheduler.update();
 
 			// update weather
 			MWeather.update();
@@ -662,11 +703,25 @@ int main(int argc, char **argv)
 				Hooks::changeHour();
 		}
 
-		// handle events
-		MEvent.process();
+		// handle events; storms are spread over several loops, with
+		// network I/O polled in between
+		MEvent.process((uint64)MSettings.getEventTime() * 1000, MSettings.getEventCount());
 
-		// free memory for dead entities
-		MEntity.collect();
+		// free memory for dead entities, a bounded amount at a time
+		// so mass deaths and zone teardowns don't stall the loop
+		MEntity.collect((uint64)MSettings.getCollectTime() * 1000, MSettings.getCollectCount());
+
+		// end of the tick's work; dump the trace if it ran long
+		if (tick_start != 0) {
+			uint64 elapsed = Time::nsecs() - tick_start;
+			Trace::record(Trace::TICK_END, 0, elapsed / 1000);
+			if (MSettings.getTraceOverrun() > 0 && elapsed >= (uint64)MSettings.getTraceOverrun() * 1000000 &&
+					time(NULL) - last_trace_dump >= 60) {
+				Log::Warning << "Tick " << game_ticks << " took " << elapsed / 1000000 << "ms";
+				last_trace_dump = time(NULL);
+				Trace::dump();
+			}
+		}
 
 		// do auto-save
 		if ((cur_ticks - last_autosave) >= (uint)MSettings.getAutoSave() * TICKS_PER_ROUND * 60) {
@@ -683,6 +738,13 @@ int main(int argc, char **argv)
 			MLog.reset();
 		}
 
+		// check for trace dump request
+		if (signaled_trace == true) {
+			signaled_trace = false;
+			Log::Info << "Server received a SIGUSR1";
+			Trace::dump();
+		}
+
 		// check for signaled_shutdown
 		if (signaled_shutdown == true) {
 			signaled_shutdown = false;
@@ -51,41 +51,48 @@ std::string EntityName::getFull() const
 	}
 }
 
+void EntityName::setText(const std::string& s_text)
+{
+	text = s_text;
+	tokens.clear();
+	tokens.add(text);
+}
+
 bool EntityName::setFull(const std::string& s_text)
 {
 	// empty text?  no article, no text
 	if (s_text.empty()) {
 		article = EntityArticleClass::NORMAL;
-		text = s_text;
+		setText(s_text);
 		return false;
 		// start with capital letter?
 	} else if (isupper(s_text[0])) {
 		article = EntityArticleClass::PROPER;
-		text = s_text;
+		setText(s_text);
 		return true;
 		// start with the article 'the'?
 	} else if (!strncasecmp("the ", s_text.c_str(), 4)) {
 		article = EntityArticleClass::UNIQUE;
-		text = std::string(s_text.c_str() + 4);
+		setText(std::string(s_text.c_str() + 4));
 		return true;
 		// start with the article 'some'?
 	} else if (!strncasecmp("some ", s_text.c_str(), 5)) {
 		article = EntityArticleClass::PLURAL;
-		text = std::string(s_text.c_str() + 5);
+		setText(std::string(s_text.c_str() + 5));
 		return true;
 		// start with the article 'an'?
 	} else if (!strncasecmp("an ", s_text.c_str(), 3)) {
 		article = EntityArticleClass::VOWEL;
-		text = std::string(s_text.c_str() + 3);
+		setText(std::string(s_text.c_str() + 3));
 		return true;
 		// start with the article 'a'?
 	} else if (!strncasecmp("a ", s_text.c_str(), 2)) {
 		article = EntityArticleClass::NORMAL;
-		text = std::string(s_text.c_str() + 2);
+		setText(std::string(s_text.c_str() + 2));
 		return true;
 		// no known article or rule... time to guess
 	} else {
-		text = s_text;
+		setText(s_text);
 		if (s_text[s_text.size() - 1] == 's') {
 			article = EntityArticleClass::PLURAL;
 		} else if (toupper(s_text[0]) == 'a' ||
@@ -101,14 +108,9 @@ bool EntityName::setFull(const std::string& s_text)
 	}
 }
 
-bool EntityName::matches(const std::string& match) const
-{
-	return phraseMatch(getText(), match);
-}
-
 const StreamControl& operator << (const StreamControl& stream, const StreamName& name)
 {
-	std::string text = name.ref.getName().getText();
+	const std::string& text = name.ref.getName().getText();
 	EntityArticleClass article = name.ref.getName().getArticle();
 
 	// PROPER NAMES (SPECIAL ARTICLES)
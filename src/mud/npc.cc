@@ -19,12 +19,14 @@
 #include "mud/hooks.h"
 #include "mud/efactory.h"
 
-Npc::Npc() : Creature()
+E_POOL_IMPL(Npc)
+
+Npc::Npc() : Creature(ET_NPC)
 {
 	initialize();
 }
 
-Npc::Npc(NpcBP* s_blueprint) : Creature()
+Npc::Npc(NpcBP* s_blueprint) : Creature(ET_NPC)
 {
 	initialize();
 	blueprint = NULL;
@@ -96,7 +98,7 @@ void Npc::saveHook(File::Writer& writer)
 	Hooks::saveNpc(this, writer);
 }
 
-EntityName Npc::getName() const
+const EntityName& Npc::getName() const
 {
 	assert(blueprint != NULL);
 	return blueprint->getName();
@@ -172,6 +174,7 @@ void Npc::heartbeat()
 void Npc::setBlueprint(NpcBP* s_blueprint)
 {
 	blueprint = s_blueprint;
+	nameChanged(); // our name may come from the blueprint
 	for (int i = 0; i < CreatureStatID::COUNT; ++i)
 		Creature::setEffectiveStat(CreatureStatID(i), getBaseStat(CreatureStatID(i)));
 	Creature::recalc();
@@ -281,9 +284,8 @@ bool Npc::nameMatch(const std::string& match) const
 	// blueprint keywords
 	NpcBP* blueprint = getBlueprint();
 	while (blueprint != NULL) {
-		for (std::vector<std::string>::const_iterator i = blueprint->getKeywords().begin(); i != blueprint->getKeywords().end(); i ++)
-			if (phraseMatch(*i, match))
-				return true;
+		if (blueprint->getKeywordTokens().matches(match))
+			return true;
 
 		blueprint = blueprint->getParent();
 	}
@@ -292,6 +294,15 @@ bool Npc::nameMatch(const std::string& match) const
 	return false;
 }
 
+void Npc::getMatchWords(std::vector<std::string>& words) const
+{
+	Creature::getMatchWords(words);
+
+	// blueprint keywords
+	for (NpcBP* blueprint = getBlueprint(); blueprint != NULL; blueprint = blueprint->getParent())
+		blueprint->getKeywordTokens().getWords(words);
+}
+
 BEGIN_EFACTORY(NPC)
 	return new Npc();
 END_EFACTORY
@@ -151,6 +151,7 @@ int NpcBP::load(File::Reader& reader)
 	setName(node.getString());
 	FO_ATTR("blueprint", "keyword")
 	keywords.push_back(node.getString());
+	keyword_tokens.add(node.getString());
 	FO_ATTR("blueprint", "desc")
 	setDesc(node.getString());
 	FO_ATTR("blueprint", "gender")
@@ -26,12 +26,14 @@ std::string ObjectLocation::names[] = {
 	"MAX"
 };
 
-Object::Object() : owner(0), blueprint(0), calc_weight(0), trash_timer(0)
+E_POOL_IMPL(Object)
+
+Object::Object() : Entity(ET_OBJECT), owner(0), blueprint(0), calc_weight(0), trash_timer(0)
 {
 	blueprint = new ObjectBP();
 }
 
-Object::Object(ObjectBP* s_blueprint) : owner(0), blueprint(s_blueprint), calc_weight(0), trash_timer(0)
+Object::Object(ObjectBP* s_blueprint) : Entity(ET_OBJECT), owner(0), blueprint(s_blueprint), calc_weight(0), trash_timer(0)
 {
 }
 
@@ -64,7 +66,7 @@ void Object::saveData(File::Writer& writer)
 		writer.attr("object", "location", "on");
 
 	// save children objects
-	for (EList<Object>::const_iterator e = children.begin(); e != children.end(); ++e) {
+	for (IndexedEList<Object>::const_iterator e = children.begin(); e != children.end(); ++e) {
 		(*e)->save(writer, "object", "child");
 	}
 }
@@ -113,7 +115,7 @@ int Object::loadNode(File::Reader& reader, File::Node& node)
 	else
 		setBlueprint(blueprint);
 	FO_ATTR("object", "name")
-	name.setFull(node.getString());
+	setName(node.getString());
 	FO_ENTITY("object", "child")
 	if (OBJECT(entity) == NULL) throw File::Error("Object child is not an Object");
 	OBJECT(entity)->setOwner(this);
@@ -139,10 +141,9 @@ void Object::ownerRelease(Entity* child)
 	assert(obj != NULL);
 
 	// find it
-	EList<Object>::iterator e = std::find(children.begin(), children.end(), obj);
-	if (e != children.end()) {
+	if (children.has(obj)) {
 		obj->in_container = ObjectLocation::NONE;
-		children.erase(e);
+		children.remove(obj);
 		return;
 	}
 }
@@ -181,13 +182,13 @@ void Object::activate()
 {
 	Entity::activate();
 
-	for (EList<Object>::iterator e = children.begin(); e != children.end(); ++e)
+	for (IndexedEList<Object>::iterator e = children.begin(); e != children.end(); ++e)
 		(*e)->activate();
 }
 
 void Object::deactivate()
 {
-	for (EList<Object>::iterator e = children.begin(); e != children.end(); ++e)
+	for (IndexedEList<Object>::iterator e = children.begin(); e != children.end(); ++e)
 		(*e)->deactivate();
 
 	Entity::deactivate();
@@ -223,7 +224,7 @@ void Object::showContents(Player *player, ObjectLocation container) const
 	int displayed = 0;
 
 	// show objects
-	for (EList<Object>::const_iterator i = children.begin(); i != children.end(); ++i) {
+	for (IndexedEList<Object>::const_iterator i = children.begin(); i != children.end(); ++i) {
 		// not right container?
 		if ((*i)->in_container != container)
 			continue;
@@ -268,7 +269,7 @@ Object* Object::findObject(const std::string& name, uint index, ObjectLocation c
 	if (matches)
 		*matches = 0;
 
-	for (EList<Object>::const_iterator i = children.begin(); i != children.end(); ++i) {
+	for (IndexedEList<Object>::const_iterator i = children.begin(); i != children.end(); ++i) {
 		// right container container
 		if ((*i)->in_container == container) {
 			// check name
@@ -291,7 +292,7 @@ void Object::recalcWeight()
 	calc_weight = 0;
 
 	// add up weight of objects
-	for (EList<Object>::const_iterator i = children.begin(); i != children.end(); ++i)
+	for (IndexedEList<Object>::const_iterator i = children.begin(); i != children.end(); ++i)
 		calc_weight += (*i)->getWeight();
 }
 
@@ -316,11 +317,12 @@ Creature* Object::getHolder() const
 bool Object::setName(const std::string& s_name)
 {
 	bool ret = name.setFull(s_name);
+	nameChanged();
 	return ret;
 }
 
 // get object name information
-EntityName Object::getName() const
+const EntityName& Object::getName() const
 {
 	assert(blueprint != NULL);
 	if (name.empty())
@@ -380,7 +382,7 @@ void Object::handleEvent(const Event& event)
 
 void Object::broadcastEvent(const Event& event)
 {
-	for (EList<Object>::const_iterator i = children.begin(); i != children.end(); ++i)
+	for (IndexedEList<Object>::const_iterator i = children.begin(); i != children.end(); ++i)
 		MEvent.resend(event, *i);
 }
 
@@ -389,6 +391,7 @@ void Object::setBlueprint(ObjectBP* s_blueprint)
 	if (blueprint != NULL && blueprint->isAnonymous())
 		delete blueprint;
 	blueprint = s_blueprint;
+	nameChanged(); // our name and keywords may come from the blueprint
 }
 
 // load object from a blueprint
@@ -418,16 +421,23 @@ bool Object::nameMatch(const std::string& match) const
 
 	// blueprint keywords
 	ObjectBP* blueprint = getBlueprint();
-	if (blueprint != NULL) {
-		for (std::vector<std::string>::const_iterator i = blueprint->getKeywords().begin(); i != blueprint->getKeywords().end(); ++i)
-			if (phraseMatch(*i, match))
-				return true;
-	}
+	if (blueprint != NULL && blueprint->getKeywordTokens().matches(match))
+		return true;
 
 	// no match
 	return false;
 }
 
+void Object::getMatchWords(std::vector<std::string>& words) const
+{
+	Entity::getMatchWords(words);
+
+	// blueprint keywords
+	ObjectBP* blueprint = getBlueprint();
+	if (blueprint != NULL)
+		blueprint->getKeywordTokens().getWords(words);
+}
+
 BEGIN_EFACTORY(Object)
 return new Object();
 END_EFACTORY
@@ -29,7 +29,7 @@ bool ObjectBP::setName(const std::string& s_name)
 	return ret;
 }
 
-EntityName ObjectBP::getName() const
+const EntityName& ObjectBP::getName() const
 {
 	return name;
 }
@@ -102,6 +102,7 @@ int ObjectBP::load(File::Reader& reader)
 	setName(node.getString());
 	FO_ATTR("blueprint", "keyword")
 	keywords.push_back(node.getString());
+	keyword_tokens.add(node.getString());
 	FO_ATTR("blueprint", "desc")
 	setDesc(node.getString());
 	FO_ATTR("blueprint", "weight")
@@ -30,7 +30,7 @@ enum OLCMode {
 
 #define OLC_BEGIN_TYPE(type) \
 	if (1) { \
-		type* edit = dynamic_cast<type*>(olc_entity); \
+		type* edit = E_CAST(olc_entity, type); \
 	if (edit != NULL) {
 #define OLC_BEGIN_ATTR(attr_name) \
 	if (olc_mode == OLC_MODE_LIST || prefixMatch(#attr_name, olc_attr)) { \
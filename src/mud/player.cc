@@ -106,7 +106,9 @@ namespace
 	}
 }
 
-Player::Player(std::tr1::shared_ptr<class Account> s_account, const std::string& s_id)
+E_POOL_IMPL(Player)
+
+Player::Player(std::tr1::shared_ptr<class Account> s_account, const std::string& s_id) : Creature(ET_PLAYER)
 {
 	// initialize
 	account = s_account;
@@ -233,6 +235,7 @@ int Player::loadNode(File::Reader& reader, File::Node& node)
 	FO_ATTR("player", "name")
 	name.setText(node.getString());
 	name.setArticle(EntityArticleClass::PROPER);
+	nameChanged();
 	// description
 	FO_ATTR("player", "desc")
 	setDesc(node.getString());
@@ -0,0 +1,201 @@
+/*
+ * Source MUD
+ * Copyright (C) 2000-2005  Sean Middleditch
+ * See the file COPYING for license details
+ * http://www.sourcemud.org
+ */
+
+#include "common.h"
+#include "mud/pool.h"
+
+namespace {
+	// all blocks and slab headers are aligned to this
+	const size_t POOL_ALIGN = 16;
+
+	// target slab size in bytes; small classes get more per slab
+	const size_t POOL_SLAB_BYTES = 64 * 1024;
+
+	// never less than this many objects per slab
+	const size_t POOL_SLAB_MIN = 16;
+
+	inline size_t align(size_t size)
+	{
+		return (size + POOL_ALIGN - 1) & ~(POOL_ALIGN - 1);
+	}
+}
+
+// a slab holds per_slab blocks, following the (aligned) header
+struct EntityPool::Slab {
+	Slab* prev;
+	Slab* next;
+	Block* free;
+	size_t used;
+};
+
+// every block starts with a header pointing at its slab; the
+// object itself lives just after the (aligned) header
+struct EntityPool::Block {
+	Slab* slab;
+	Block* next;
+};
+
+std::vector<EntityPool*>* EntityPool::pools()
+{
+	static std::vector<EntityPool*>* list = new std::vector<EntityPool*>;
+	return list;
+}
+
+EntityPool::EntityPool(const char* s_name, size_t s_size) : name(s_name),
+	object_size(s_size), partial(NULL), slab_count(0), live(0), peak(0),
+	allocs(0), frees(0)
+{
+	block_size = align(sizeof(Block)) + align(object_size);
+	per_slab = POOL_SLAB_BYTES / block_size;
+	if (per_slab < POOL_SLAB_MIN)
+		per_slab = POOL_SLAB_MIN;
+
+	pools()->push_back(this);
+}
+
+EntityPool::~EntityPool()
+{
+	std::vector<EntityPool*>::iterator i = std::find(pools()->begin(), pools()->end(), this);
+	if (i != pools()->end())
+		pools()->erase(i);
+}
+
+void EntityPool::grow()
+{
+	Slab* slab = (Slab*)malloc(align(sizeof(Slab)) + per_slab * block_size);
+	if (slab == NULL)
+		throw std::bad_alloc();
+
+	// thread all blocks onto the slab's free list
+	char* base = (char*)slab + align(sizeof(Slab));
+	slab->free = NULL;
+	slab->used = 0;
+	for (size_t i = per_slab; i > 0; --i) {
+		Block* block = (Block*)(base + (i - 1) * block_size);
+		block->slab = slab;
+		block->next = slab->free;
+		slab->free = block;
+	}
+
+	// link into partial list
+	slab->prev = NULL;
+	slab->next = partial;
+	if (partial != NULL)
+		partial->prev = slab;
+	partial = slab;
+
+	++slab_count;
+}
+
+void EntityPool::freeSlab(Slab* slab)
+{
+	if (slab->prev != NULL)
+		slab->prev->next = slab->next;
+	if (slab->next != NULL)
+		slab->next->prev = slab->prev;
+	if (partial == slab)
+		partial = slab->next;
+
+	free(slab);
+	--slab_count;
+}
+
+void* EntityPool::allocate(size_t size)
+{
+	// sub-classes of a pooled class that didn't declare
+	// their own pool fall back on the global heap
+	if (size != object_size)
+		return ::operator new(size);
+
+	if (partial == NULL)
+		grow();
+
+	// take the first free block of the first partial slab
+	Slab* slab = partial;
+	Block* block = slab->free;
+	slab->free = block->next;
+	++slab->used;
+
+	// slab is full, unlink it from the partial list
+	if (slab->free == NULL) {
+		partial = slab->next;
+		if (partial != NULL)
+			partial->prev = NULL;
+		slab->next = NULL;
+	}
+
+	++allocs;
+	if (++live > peak)
+		peak = live;
+
+	return (char*)block + align(sizeof(Block));
+}
+
+void EntityPool::release(void* ptr, size_t size)
+{
+	if (ptr == NULL)
+		return;
+
+	if (size != object_size) {
+		::operator delete(ptr);
+		return;
+	}
+
+	// defer until collect()
+	pending.push_back(ptr);
+	--live;
+	++frees;
+}
+
+void EntityPool::collect()
+{
+	if (pending.empty())
+		return;
+
+	// sorting groups blocks by slab, so we walk each slab once
+	std::sort(pending.begin(), pending.end());
+
+	for (std::vector<void*>::iterator i = pending.begin(); i != pending.end(); ++i) {
+		Block* block = (Block*)((char*)*i - align(sizeof(Block)));
+		Slab* slab = block->slab;
+
+		// slab was full; it goes back on the partial list
+		if (slab->free == NULL) {
+			slab->prev = NULL;
+			slab->next = partial;
+			if (partial != NULL)
+				partial->prev = slab;
+			partial = slab;
+		}
+
+		block->next = slab->free;
+		slab->free = block;
+		--slab->used;
+	}
+	pending.clear();
+
+	// release empty slabs, keeping one around to absorb the
+	// next spawn without going back to malloc
+	bool keep = true;
+	Slab* slab = partial;
+	while (slab != NULL) {
+		Slab* next = slab->next;
+		if (slab->used == 0) {
+			if (keep)
+				keep = false;
+			else
+				freeSlab(slab);
+		}
+		slab = next;
+	}
+}
+
+void EntityPool::collectAll()
+{
+	for (std::vector<EntityPool*>::iterator i = pools()->begin(); i != pools()->end(); ++i)
+		(*i)->collect();
+}
@@ -237,21 +237,39 @@ PortalDetail PortalDetail::lookup(const std::string& name)
 	return NONE;
 }
 
-Portal::Portal() : parent_room(NULL)
+E_POOL_IMPL(Portal)
+
+Portal::Portal() : Entity(ET_PORTAL), target_entry(NULL), parent_room(NULL)
 {}
 
-EntityName Portal::getName() const
+const EntityName& Portal::getName() const
 {
 	// default name w/ direction
-	if (name.empty())
-		return EntityName(EntityArticleClass::UNIQUE, dir.getName());
-	else
+	static std::vector<EntityName> dir_names;
+	if (name.empty()) {
+		if (dir_names.empty())
+			for (int i = 0; i < PortalDir::COUNT; ++i)
+				dir_names.push_back(EntityName(EntityArticleClass::UNIQUE, PortalDir(i).getName()));
+		return dir_names[dir.getValue()];
+	} else
 		return name;
 }
 
 void Portal::addKeyword(const std::string& keyword)
 {
 	keywords.push_back(keyword);
+	keyword_tokens.add(keyword);
+	nameChanged();
+}
+
+Room* Portal::getTargetRoom() const
+{
+	if (target_entry == NULL) {
+		target_entry = MZone.getRoomEntry(target);
+		if (target_entry == NULL)
+			return NULL;
+	}
+	return target_entry->getRoom();
 }
 
 Room* Portal::getRelativeTarget(Room* base) const
@@ -260,9 +278,9 @@ Room* Portal::getRelativeTarget(Room* base) const
 
 	// if we're asking about the owner, return the 'target' room
 	if (base == parent_room)
-		return MZone.getRoom(target);
+		return getTargetRoom();
 	// if we're the target room, return the owner
-	else if (base->getId() == target)
+	else if (base == getTargetRoom())
 		return parent_room;
 	// otherwise, we're not involved with this portal at all
 	else
@@ -279,7 +297,7 @@ Portal* Portal::getRelativePortal(Room* base) const
 
 	// if we're the portal's owner, get the target's opposite portal
 	if (base == parent_room) {
-		Room* room = MZone.getRoom(target);
+		Room* room = getTargetRoom();
 		if (room == NULL)
 			return NULL;
 		return room->getPortalByDir(dir.getOpposite());
@@ -297,7 +315,7 @@ PortalDir Portal::getRelativeDir(Room* base) const
 	if (base == parent_room)
 		return dir;
 	// target uses the opposite dir
-	else if (base->getId() == target)
+	else if (base == getTargetRoom())
 		return dir.getOpposite();
 	// we're not related to this room
 	else
@@ -308,12 +326,12 @@ bool Portal::hasRoom(Room* base) const
 {
 	assert(base != NULL);
 
-	return (base == parent_room || base->getId() == target);
+	return (base == parent_room || base == getTargetRoom());
 }
 
 bool Portal::isValid() const
 {
-	return !target.empty() && MZone.getRoom(target);
+	return getTargetRoom() != NULL;
 }
 
 void Portal::saveData(File::Writer& writer)
@@ -367,7 +385,7 @@ int Portal::loadNode(File::Reader& reader, File::Node& node)
 	FO_ATTR("portal", "name")
 	setName(node.getString());
 	FO_ATTR("portal", "keyword")
-	keywords.push_back(node.getString());
+	addKeyword(node.getString());
 	FO_ATTR("portal", "desc")
 	setDesc(node.getString());
 	FO_ATTR("portal", "usage")
@@ -393,7 +411,7 @@ int Portal::loadNode(File::Reader& reader, File::Node& node)
 	FO_ATTR("portal", "disabled")
 	setDisabled(node.getBool());
 	FO_ATTR("portal", "target")
-	target = node.getString();
+	setTarget(node.getString());
 	FO_PARENT(Entity)
 	FO_NODE_END
 }
@@ -493,9 +511,8 @@ bool Portal::nameMatch(const std::string& match) const
 		return true;
 
 	// try keywords
-	for (std::vector<std::string>::const_iterator i = keywords.begin(); i != keywords.end(); i ++)
-		if (phraseMatch(*i, match))
-			return true;
+	if (keyword_tokens.matches(match))
+		return true;
 
 	// no match
 	return false;
@@ -506,7 +523,7 @@ void Portal::activate()
 	Entity::activate();
 
 	if (!isOneway()) {
-		Room* room = MZone.getRoom(target);
+		Room* room = getTargetRoom();
 		if (room != NULL) {
 			if (!room->registerPortal(this)) {
 				Log::Warning << "Room '" << room->getId() << "' already has portal for direction " << getDir().getOpposite().getName() << ", converting " << getDir().getName() << " portal of room '" << parent_room->getId() << "' to one-way";
@@ -519,7 +536,7 @@ void Portal::activate()
 void Portal::deactivate()
 {
 	if (!isOneway()) {
-		Room* room = MZone.getRoom(target);
+		Room* room = getTargetRoom();
 		if (room != NULL)
 			room->unregisterPortal(this);
 	}
@@ -527,6 +544,19 @@ void Portal::deactivate()
 	Entity::deactivate();
 }
 
+void Portal::eventMaskChanged(EventMask old_mask)
+{
+	Entity::eventMaskChanged(old_mask);
+
+	// only if the target room took us in registerPortal()
+	Room* room = getTargetRoom();
+	if (room != NULL) {
+		std::map<PortalDir, Portal*>::iterator i = room->portals.find(getDir().getOpposite());
+		if (i != room->portals.end() && i->second == this)
+			room->updateSubscriber(old_mask, getEventMask());
+	}
+}
+
 void Portal::handleEvent(const Event& event)
 {
 	Entity::handleEvent(event);
@@ -26,7 +26,9 @@
 #include "mud/weather.h"
 
 /* constructor */
-Room::Room()
+E_POOL_IMPL(Room)
+
+Room::Room() : Entity(ET_ROOM)
 {
 	/* clear de values */
 	zone = NULL;
@@ -38,6 +40,23 @@ Room::Room()
 
 Room::~Room()
 {
+	MZone.unindexRoom(this);
+}
+
+void Room::setId(const std::string& new_id)
+{
+	// re-key the room index if we're in the world
+	if (zone != NULL)
+		MZone.unindexRoom(this);
+	id = new_id;
+	if (zone != NULL)
+		MZone.indexRoom(this);
+}
+
+void Room::destroy()
+{
+	MZone.unindexRoom(this);
+	Entity::destroy();
 }
 
 int Room::loadNode(File::Reader& reader, File::Node& node)
@@ -74,6 +93,7 @@ int Room::loadNode(File::Reader& reader, File::Node& node)
 		// add
 		portal->parent_room = this;
 		portals[portal->getDir()] = portal;
+		subscribers.add(portal->getEventMask());
 
 		// activate if necessary
 		if (isActive())
@@ -118,10 +138,10 @@ void Room::saveData(File::Writer& writer)
 			i->second->save(writer, "room", "child");
 	}
 
-	for (EList<Object>::const_iterator i = objects.begin(); i != objects.end(); ++i)
+	for (IndexedEList<Object>::const_iterator i = objects.begin(); i != objects.end(); ++i)
 		(*i)->save(writer, "room", "child");
 
-	for (EList<Creature>::const_iterator i = creatures.begin(); i != creatures.end(); ++i) {
+	for (IndexedEList<Creature>::const_iterator i = creatures.begin(); i != creatures.end(); ++i) {
 		if (NPC(*i))
 			(*i)->save(writer, "room", "child");
 	}
@@ -168,6 +188,7 @@ Portal* Room::newPortal(PortalDir dir)
 	portal->setDir(dir);
 	portal->parent_room = this;
 	portals[dir] = portal;
+	subscribers.add(portal->getEventMask());
 	if (isActive())
 		portal->activate();
 	return portal;
@@ -181,6 +202,7 @@ bool Room::registerPortal(Portal* portal)
 	std::map<PortalDir, Portal*>::iterator i = portals.find(portal->getDir().getOpposite());
 	if (i == portals.end()) {
 		portals[portal->getDir().getOpposite()] = portal;
+		subscribers.add(portal->getEventMask());
 		return true;
 	} else if (i->second == portal)
 		return true; // already registered
@@ -194,8 +216,10 @@ void Room::unregisterPortal(Portal* portal)
 	assert(portal->getTarget() == getId());
 
 	std::map<PortalDir, Portal*>::iterator i = portals.find(portal->getDir().getOpposite());
-	if (i != portals.end() && i->second == portal)
+	if (i != portals.end() && i->second == portal) {
+		subscribers.remove(portal->getEventMask());
 		portals.erase(i);
+	}
 }
 
 // coins
@@ -223,10 +247,10 @@ void Room::activate()
 		if (i->second->getRoom() == this)
 			i->second->activate();
 
-	for (EList<Creature>::const_iterator i = creatures.begin(); i != creatures.end(); ++i)
+	for (IndexedEList<Creature>::const_iterator i = creatures.begin(); i != creatures.end(); ++i)
 		(*i)->activate();
 
-	for (EList<Object>::const_iterator i = objects.begin(); i != objects.end(); ++i)
+	for (IndexedEList<Object>::const_iterator i = objects.begin(); i != objects.end(); ++i)
 		(*i)->activate();
 }
 
@@ -237,10 +261,10 @@ void Room::deactivate()
 			i->second->deactivate();
 	}
 
-	for (EList<Creature>::const_iterator i = creatures.begin(); i != creatures.end(); ++i)
+	for (IndexedEList<Creature>::const_iterator i = creatures.begin(); i != creatures.end(); ++i)
 		(*i)->deactivate();
 
-	for (EList<Object>::const_iterator i = objects.begin(); i != objects.end(); ++i)
+	for (IndexedEList<Object>::const_iterator i = objects.begin(); i != objects.end(); ++i)
 		(*i)->deactivate();
 
 	Entity::deactivate();
@@ -260,14 +284,20 @@ void Room::ownerRelease(Entity* child)
 	// Creature?
 	Creature* ch = CHARACTER(child);
 	if (ch != NULL) {
-		creatures.remove(ch);
+		if (creatures.has(ch)) {
+			subscribers.remove(ch->getEventMask());
+			creatures.remove(ch);
+		}
 		return;
 	}
 
 	// Object?
 	Object* obj = OBJECT(child);
 	if (obj != NULL) {
-		objects.remove(obj);
+		if (objects.has(obj)) {
+			subscribers.remove(obj->getEventMask());
+			objects.remove(obj);
+		}
 		return;
 	}
 
@@ -275,8 +305,10 @@ void Room::ownerRelease(Entity* child)
 	Portal* portal = PORTAL(child);
 	if (portal != NULL) {
 		std::map<PortalDir, Portal*>::iterator i = portals.find(portal->getDir());
-		if (i != portals.end() && i->second == portal)
+		if (i != portals.end() && i->second == portal) {
+			subscribers.remove(portal->getEventMask());
 			portals.erase(i);
+		}
 	}
 
 	// something we don't support
@@ -347,7 +379,7 @@ void Room::show(const StreamControl& stream, Creature* viewer)
 	// show players and NPCs
 	if (!creatures.empty()) {
 		// iterator
-		for (EList<Creature>::const_iterator i = creatures.begin(); i != creatures.end(); ++i) {
+		for (IndexedEList<Creature>::const_iterator i = creatures.begin(); i != creatures.end(); ++i) {
 			// not ourselves
 			if ((Creature*)(*i) != viewer) {
 				// have we a last entry?
@@ -373,7 +405,7 @@ void Room::show(const StreamControl& stream, Creature* viewer)
 	// object list
 	if (!objects.empty()) {
 		// iterator
-		for (EList<Object>::const_iterator i = objects.begin(); i != objects.end(); ++i) {
+		for (IndexedEList<Object>::const_iterator i = objects.begin(); i != objects.end(); ++i) {
 			// no hidden?
 			if (!(*i)->isHidden()) {
 				// have we a last item?
@@ -448,7 +480,7 @@ void Room::showPortals(const StreamControl& stream)
 void Room::put(const std::string& msg, size_t len, std::vector<Creature*>* ignore_list)
 {
 	// iterator
-	for (EList<Creature>::iterator i = creatures.begin(); i != creatures.end(); ++i) {
+	for (IndexedEList<Creature>::iterator i = creatures.begin(); i != creatures.end(); ++i) {
 		// skip ignored creatures
 		if (ignore_list != NULL) {
 			if (std::find(ignore_list->begin(), ignore_list->end(), (*i)) != ignore_list->end())
@@ -481,6 +513,7 @@ void Room::addCreature(Creature* creature)
 
 	creature->setOwner(this);
 	creatures.add(creature);
+	subscribers.add(creature->getEventMask());
 }
 
 void Room::addObject(Object* object)
@@ -489,17 +522,25 @@ void Room::addObject(Object* object)
 
 	object->setOwner(this);
 	objects.add(object);
+	subscribers.add(object->getEventMask());
 }
 
 unsigned long Room::countPlayers() const
 {
 	unsigned long count = 0;
-	for (EList<Creature>::const_iterator i = creatures.begin(); i != creatures.end(); ++i)
+	for (IndexedEList<Creature>::const_iterator i = creatures.begin(); i != creatures.end(); ++i)
 		if (PLAYER(*i))
 			++count;
 	return count;
 }
 
+void Room::eventMaskChanged(EventMask old_mask)
+{
+	// the zone's mask only grows, like it does in Zone::addRoom()
+	if (zone != NULL)
+		zone->addRoomEvents(getEventMask());
+}
+
 void Room::handleEvent(const Event& event)
 {
 	Entity::handleEvent(event);
@@ -507,12 +548,16 @@ void Room::handleEvent(const Event& event)
 
 void Room::broadcastEvent(const Event& event)
 {
+	// nothing in here cares
+	if (!(subscribers.getMask() & event.getId().getMask()))
+		return;
+
 	// propogate to objects
-	for (EList<Object>::const_iterator i = objects.begin(); i != objects.end(); ++i)
+	for (IndexedEList<Object>::const_iterator i = objects.begin(); i != objects.end(); ++i)
 		MEvent.resend(event, *i);
 
 	// propogate to creatures
-	for (EList<Creature>::const_iterator i = creatures.begin(); i != creatures.end(); ++i)
+	for (IndexedEList<Creature>::const_iterator i = creatures.begin(); i != creatures.end(); ++i)
 		MEvent.resend(event, *i);
 
 	// propogate to portals
@@ -0,0 +1,331 @@
+/*
+ * Source MUD
+ * Copyright (C) 2000-2005  Sean Middleditch
+ * See the file COPYING for license details
+ * http://www.sourcemud.org
+ */
+
+#include "common.h"
+#include "common/log.h"
+#include "mud/scheduler.h"
+#include "mud/entity.h"
+#include "mud/clock.h"
+#include "lua/core.h"
+#include "lib/lua51/lua.h"
+#include "lib/lua51/lauxlib.h"
+
+_MScheduler MScheduler;
+
+namespace {
+	// push an entity, or nil, onto a thread's stack
+	void pushEntity(lua_State* thread, Entity* entity)
+	{
+		if (entity != NULL) {
+			entity->pushLuaTable();
+			lua_xmove(Lua::state, thread, 1);
+		} else {
+			lua_pushnil(thread);
+		}
+	}
+
+	void eraseFrom(std::multimap<uint32, uint32>& map, uint32 key, uint32 id)
+	{
+		typedef std::multimap<uint32, uint32>::iterator iterator;
+		std::pair<iterator, iterator> range = map.equal_range(key);
+		for (iterator i = range.first; i != range.second; ++i) {
+			if (i->second == id) {
+				map.erase(i);
+				return;
+			}
+		}
+	}
+}
+
+int _MScheduler::initialize()
+{
+	if (require(MEntity) != 0)
+		return 1;
+
+	return 0;
+}
+
+void _MScheduler::shutdown()
+{
+	if (Lua::state != NULL)
+		for (std::vector<Thread>::iterator i = threads.begin(); i != threads.end(); ++i)
+			if (i->state != NULL)
+				luaL_unref(Lua::state, LUA_REGISTRYINDEX, i->ref);
+
+	std::vector<Thread>().swap(threads);
+	std::vector<uint32>().swap(free_threads);
+	std::vector<Timer>().swap(timers);
+	by_state.clear();
+	waiters.clear();
+	owned.clear();
+}
+
+void _MScheduler::spawn(lua_State* s, int nargs, Entity* owner)
+{
+	// the thread lives in the registry until it finishes or is killed
+	lua_State* state = lua_newthread(Lua::state);
+	int ref = luaL_ref(Lua::state, LUA_REGISTRYINDEX);
+	lua_xmove(s, state, nargs + 1);
+
+	uint32 id;
+	if (!free_threads.empty()) {
+		id = free_threads.back();
+		free_threads.pop_back();
+	} else {
+		id = threads.size();
+		threads.push_back(Thread());
+		threads[id].generation = 0;
+	}
+
+	Thread& thread = threads[id];
+	thread.state = state;
+	thread.ref = ref;
+	thread.owner = owner != NULL ? owner->getHandle() : EntityHandle();
+	thread.owned = owner != NULL;
+	thread.waiting = EntityHandle();
+	thread.events = 0;
+	thread.parked = false;
+	thread.running = false;
+	thread.killed = false;
+
+	by_state[state] = id;
+	if (owner != NULL)
+		owned.insert(std::make_pair(owner->getHandle().getSlot(), id));
+
+	resume(id, nargs);
+}
+
+int _MScheduler::find(lua_State* s) const
+{
+	std::map<lua_State*, uint32>::const_iterator i = by_state.find(s);
+	if (i == by_state.end() || !threads[i->second].running)
+		return -1;
+	return i->second;
+}
+
+void _MScheduler::park(uint32 id)
+{
+	Thread& thread = threads[id];
+
+	if (thread.park_ticks != 0) {
+		Timer timer;
+		timer.wake = MUD::getTicks() + thread.park_ticks;
+		timer.thread = id;
+		timer.generation = thread.generation;
+		timers.push_back(timer);
+		std::push_heap(timers.begin(), timers.end());
+	}
+
+	Entity* entity = thread.park_on.get();
+	if (entity != NULL) {
+		thread.waiting = thread.park_on;
+		thread.events = thread.park_events;
+		waiters.insert(std::make_pair(thread.park_on.getSlot(), id));
+		entity->setWaitMask(entity->getWaitMask() | thread.park_events);
+	}
+}
+
+// these only note what to park on; resume() parks the thread once
+// it has actually yielded, as the yield fails inside a pcall()
+bool _MScheduler::sleep(lua_State* s, uint32 ticks)
+{
+	int id = find(s);
+	if (id < 0)
+		return false;
+
+	Thread& thread = threads[id];
+	thread.parked = true;
+	thread.park_ticks = ticks != 0 ? ticks : 1;
+	thread.park_on = EntityHandle();
+	thread.park_events = 0;
+	return true;
+}
+
+bool _MScheduler::waitEvent(lua_State* s, Entity* entity, EventMask events, uint32 timeout_ticks)
+{
+	int id = find(s);
+	if (id < 0)
+		return false;
+
+	Thread& thread = threads[id];
+	thread.parked = true;
+	thread.park_ticks = timeout_ticks;
+	thread.park_on = entity->getHandle();
+	thread.park_events = events;
+	return true;
+}
+
+void _MScheduler::unwait(uint32 id, bool freeing)
+{
+	Thread& thread = threads[id];
+	if (thread.waiting.getSlot() == 0)
+		return;
+
+	uint32 slot = thread.waiting.getSlot();
+	Entity* entity = freeing ? NULL : thread.waiting.get();
+	eraseFrom(waiters, slot, id);
+	thread.waiting = EntityHandle();
+	thread.events = 0;
+
+	// the entity listens for whatever the remaining waiters want
+	if (entity != NULL) {
+		EventMask mask = 0;
+		std::pair<SlotMap::iterator, SlotMap::iterator> range = waiters.equal_range(slot);
+		for (SlotMap::iterator i = range.first; i != range.second; ++i)
+			mask |= threads[i->second].events;
+		entity->setWaitMask(mask);
+	}
+}
+
+void _MScheduler::kill(uint32 id)
+{
+	Thread& thread = threads[id];
+	if (thread.state == NULL)
+		return;
+
+	// can't free a thread out from under itself; resume() frees it
+	// once it yields
+	if (thread.running) {
+		thread.killed = true;
+		return;
+	}
+
+	unwait(id);
+	if (thread.owned)
+		eraseFrom(owned, thread.owner.getSlot(), id);
+
+	by_state.erase(thread.state);
+	if (Lua::state != NULL)
+		luaL_unref(Lua::state, LUA_REGISTRYINDEX, thread.ref);
+
+	thread.state = NULL;
+	thread.owned = false;
+	thread.owner = EntityHandle();
+	++thread.generation;
+	free_threads.push_back(id);
+}
+
+void _MScheduler::resume(uint32 id, int nargs)
+{
+	lua_State* state = threads[id].state;
+
+	// an owned thread whose owner is gone has nothing left to do
+	if (threads[id].owned && threads[id].owner.get() == NULL) {
+		kill(id);
+		return;
+	}
+
+	// expires any timer left from the last park
+	++threads[id].generation;
+	threads[id].parked = false;
+	threads[id].running = true;
+	++resumed;
+
+	int rs = Lua::resume(state, nargs);
+
+	// spawns while running may have moved the vector
+	Thread& thread = threads[id];
+	thread.running = false;
+
+	if (thread.killed) {
+		thread.killed = false;
+	} else if (rs == LUA_YIELD) {
+		if (thread.parked) {
+			park(id);
+			return;
+		}
+		Log::Error << "Lua: thread yielded outside of mud.sleep or mud.waitEvent";
+	} else if (rs != 0) {
+		Log::Error << "Lua: " << lua_tostring(state, -1);
+	}
+
+	kill(id);
+}
+
+void _MScheduler::update()
+{
+	uint64 now = MUD::getTicks();
+
+	// threads parked during the loop always wake on a later tick,
+	// so this ends
+	while (!timers.empty() && timers.front().wake <= now) {
+		Timer timer = timers.front();
+		std::pop_heap(timers.begin(), timers.end());
+		timers.pop_back();
+
+		Thread& thread = threads[timer.thread];
+		if (thread.state == NULL || thread.generation != timer.generation)
+			continue;
+
+		// a timed out waitEvent returns nothing
+		unwait(timer.thread);
+		resume(timer.thread, 0);
+	}
+}
+
+void _MScheduler::wake(Entity* recipient, const Event& event)
+{
+	EntityHandle handle = recipient->getHandle();
+
+	// find the waiters first; resuming them changes the map
+	std::vector<std::pair<uint32, uint32> > ready;
+	std::pair<SlotMap::iterator, SlotMap::iterator> range = waiters.equal_range(handle.getSlot());
+	for (SlotMap::iterator i = range.first; i != range.second; ++i) {
+		const Thread& thread = threads[i->second];
+		if (thread.waiting == handle && (thread.events & event.getId().getMask()))
+			ready.push_back(std::make_pair(i->second, thread.generation));
+	}
+
+	for (size_t i = 0; i < ready.size(); ++i) {
+		uint32 id = ready[i].first;
+		Thread& thread = threads[id];
+		if (thread.state == NULL || thread.generation != ready[i].second)
+			continue;
+
+		// mud.waitEvent returns the event name and its aux entities
+		unwait(id);
+		lua_pushstring(thread.state, event.getId().getName().c_str());
+		pushEntity(thread.state, event.getAux1());
+		pushEntity(thread.state, event.getAux2());
+		pushEntity(thread.state, event.getAux3());
+		resume(id, 4);
+	}
+}
+
+void _MScheduler::cancel(Entity* entity, bool freeing)
+{
+	EntityHandle handle = entity->getHandle();
+	std::vector<uint32> ids;
+
+	// waits on the entity time out on the next tick; resuming them
+	// now would run scripts in the middle of the destroy.  these go
+	// first, so killing a thread below doesn't touch the entity
+	// through a wait on it
+	std::pair<SlotMap::iterator, SlotMap::iterator> range = waiters.equal_range(handle.getSlot());
+	for (SlotMap::iterator i = range.first; i != range.second; ++i)
+		if (threads[i->second].waiting == handle)
+			ids.push_back(i->second);
+	for (size_t i = 0; i < ids.size(); ++i) {
+		unwait(ids[i], freeing);
+
+		Timer timer;
+		timer.wake = MUD::getTicks() + 1;
+		timer.thread = ids[i];
+		timer.generation = threads[ids[i]].generation;
+		timers.push_back(timer);
+		std::push_heap(timers.begin(), timers.end());
+	}
+
+	// threads the entity owns die with it
+	ids.clear();
+	range = owned.equal_range(handle.getSlot());
+	for (SlotMap::iterator i = range.first; i != range.second; ++i)
+		if (threads[i->second].owner == handle)
+			ids.push_back(i->second);
+	for (size_t i = 0; i < ids.size(); ++i)
+		kill(ids[i]);
+}
@@ -39,6 +39,8 @@ namespace
 		SETTING_STRING(log_file, 'l', "log", "log_file", "")
 		SETTING_STRING(http_log_file, 0, "http_log", "http_log_file", "")
 		SETTING_STRING(pid_file, 'p', "pid", "pid_file", "sourcemud.pid")
+		SETTING_STRING(trace_file, 0, NULL, "trace_file", "sourcemud.trace")
+		SETTING_STRING(profile_file, 0, NULL, "profile_file", "sourcemud.profile")
 		SETTING_STRING(deny_file, 0, "deny", "denied_hosts_file", "")
 		SETTING_STRING(account_path, 0, NULL, "account_dir", "data")
 		SETTING_STRING(blueprint_path, 0, NULL, "blueprint_dir", "data/blueprints")
@@ -47,6 +49,7 @@ namespace
 		SETTING_STRING(player_path, 0, NULL, "player_dir", "data")
 		SETTING_STRING(help_path, 0, NULL, "help_dir", "data/help")
 		SETTING_STRING(scripts_path, 0, NULL, "script_dir", "scripts")
+		SETTING_STRING(lua_cache_path, 0, NULL, "lua_cache_dir", "cache")
 		SETTING_STRING(world_path, 0, NULL, "world_dir", "data")
 		SETTING_STRING(misc_path, 0, NULL, "misc_dir", "data")
 		SETTING_STRING(html_path, 0, NULL, "html_dir", "data/html")
@@ -68,6 +71,7 @@ namespace
 		SETTING_BOOL(backup_players, 0, NULL, "backup_players", false)
 		SETTING_BOOL(backup_accounts, 0, NULL, "backup_accounts", false)
 		SETTING_BOOL(backup_zones, 0, NULL, "backup_zones", false)
+		SETTING_BOOL(precompile, 0, "precompile", NULL, false)
 		SETTING_INT(port, 'P', "port", "port", 4545)
 		SETTING_INT(http, 'H', "http", "http_port", 0)
 		SETTING_INT(max_per_host, 0, NULL, "max_per_host", 5)
@@ -75,6 +79,18 @@ namespace
 		SETTING_INT(characters_per_account, 0, NULL, "acct_char_limit", 3)
 		SETTING_INT(active_per_account, 0, NULL, "acct_play_limit", 1)
 		SETTING_INT(auto_save, 0, NULL, "auto_save", 15)
+		SETTING_INT(collect_time, 0, NULL, "collect_time", 2000)
+		SETTING_INT(collect_count, 0, NULL, "collect_count", 1000)
+		SETTING_INT(event_time, 0, NULL, "event_time", 5000)
+		SETTING_INT(event_count, 0, NULL, "event_count", 5000)
+		SETTING_INT(trace_overrun, 0, NULL, "trace_overrun", 250)
+		SETTING_INT(lua_instructions, 0, NULL, "lua_instructions", 1000000)
+		SETTING_INT(lua_time, 0, NULL, "lua_time", 100)
+		SETTING_INT(lua_memory, 0, NULL, "lua_memory", 0)
+		SETTING_INT(lua_gc_idle, 0, NULL, "lua_gc_idle", 5)
+		SETTING_INT(lua_gc_pause, 0, NULL, "lua_gc_pause", 400)
+		SETTING_INT(lua_gc_stepmul, 0, NULL, "lua_gc_stepmul", 200)
+		SETTING_INT(macro_cache, 0, NULL, "macro_cache", 1024)
 		SETTING_INT(telnet_timeout, 0, NULL, "telnet_timeout", 30)
 		SETTING_INT(http_timeout, 0, NULL, "http_timeout", 30)
 		{ NULL, 0, NULL, NULL, NULL, NULL, NULL, 0, "", false }
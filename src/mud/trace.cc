@@ -0,0 +1,78 @@
+/*
+ * Source MUD
+ * Copyright (C) 2000-2005  Sean Middleditch
+ * See the file COPYING for license details
+ * http://www.sourcemud.org
+ */
+
+#include "common.h"
+#include "common/log.h"
+#include "mud/trace.h"
+#include "mud/settings.h"
+
+namespace Trace
+{
+	Record ring[RING_SIZE];
+	uint64 next = 0;
+
+	namespace {
+		typedef std::map<std::string, uint16> NameMap;
+		NameMap name_ids;
+		std::vector<std::string> names(1);
+	}
+}
+
+uint16 Trace::intern(const std::string& name)
+{
+	NameMap::const_iterator i = name_ids.find(name);
+	if (i != name_ids.end())
+		return i->second;
+
+	if (names.size() > 0xFFFF)
+		return 0;
+
+	uint16 id = names.size();
+	names.push_back(name);
+	name_ids[name] = id;
+	return id;
+}
+
+std::string Trace::dump()
+{
+	std::ostringstream path;
+	path << MSettings.getTraceFile() << "." << time(NULL);
+
+	FILE* file = fopen(path.str().c_str(), "wb");
+	if (file == NULL) {
+		Log::Error << "Failed to open " << path.str() << " for writing: " << strerror(errno);
+		return std::string();
+	}
+
+	// oldest record first; before the ring first wraps, that's 0
+	uint32 count = next < RING_SIZE ? (uint32)next : (uint32)RING_SIZE;
+	uint64 first = next - count;
+
+	uint32 header[3] = { (uint32)sizeof(Record), (uint32)names.size(), count };
+	fwrite("SMTRACE1", 8, 1, file);
+	fwrite(header, sizeof(header), 1, file);
+
+	for (std::vector<std::string>::const_iterator i = names.begin(); i != names.end(); ++i) {
+		uint16 len = i->size();
+		fwrite(&len, sizeof(len), 1, file);
+		fwrite(i->data(), len, 1, file);
+	}
+
+	// the ring may wrap, so write it in up to two pieces
+	size_t start = first & (RING_SIZE - 1);
+	size_t tail = RING_SIZE - start < count ? RING_SIZE - start : count;
+	fwrite(&ring[start], sizeof(Record), tail, file);
+	fwrite(&ring[0], sizeof(Record), count - tail, file);
+
+	if (fclose(file) != 0) {
+		Log::Error << "Failed to write " << path.str() << ": " << strerror(errno);
+		return std::string();
+	}
+
+	Log::Info << "Wrote trace of " << count << " records to " << path.str();
+	return path.str();
+}
@@ -133,7 +133,7 @@ void Spawn::save(File::Writer& writer) const
 	writer.end();
 }
 
-Zone::Zone()
+Zone::Zone() : room_events(0)
 {}
 
 Room* Zone::getRoom(const std::string& id) const
@@ -238,6 +238,8 @@ void Zone::addRoom(Room *room)
 
 	room->setZone(this);
 	rooms.push_back(room);
+	room_events |= room->getEventMask();
+	MZone.indexRoom(room);
 }
 
 void Zone::heartbeat()
@@ -274,12 +276,20 @@ void Zone::destroy()
 	if (i != MZone.zones.end())
 		MZone.zones.erase(i);
 
+	// our rooms can no longer be found
+	for (RoomList::iterator r = rooms.begin(); r != rooms.end(); ++r)
+		MZone.unindexRoom(*r);
+
 	// shut down zone
 	deactivate();
 }
 
 void Zone::broadcastEvent(const Event& event)
 {
+	// no room cares
+	if (!(room_events & event.getId().getMask()))
+		return;
+
 	for (RoomList::iterator i = rooms.begin(); i != rooms.end(); ++i)
 		MEvent.resend(event, *i);
 }
@@ -297,6 +307,7 @@ int _MZone::initialize()
 		return 1;
 	if (require(MWeather) != 0)
 		return 1;
+
 	return 0;
 }
 
@@ -337,6 +348,7 @@ void _MZone::shutdown()
 	for (ZoneList::iterator i = zones.begin(), e = zones.end(); i != e; ++i)
 		delete *i;
 	zones.clear();
+	room_map.clear();
 }
 
 // save zones
@@ -373,14 +385,45 @@ Room* _MZone::getRoom(const std::string& id)
 	if (id.empty())
 		return NULL;
 
-	Room *room;
-	for (ZoneList::iterator i = zones.begin(); i != zones.end(); ++i) {
-		room = (*i)->getRoom(id);
-		if (room != NULL)
-			return room;
-	}
+	RoomMap::const_iterator i = room_map.find(strlower(id));
+	return i != room_map.end() ? i->second.getRoom() : NULL;
+}
 
-	return NULL;
+const RoomIndexEntry* _MZone::getRoomEntry(const std::string& id)
+{
+	if (id.empty())
+		return NULL;
+
+	return &room_map[strlower(id)];
+}
+
+void _MZone::indexRoom(Room* room)
+{
+	assert(room != NULL);
+
+	if (room->getId().empty())
+		return;
+
+	// the first room with an id wins, as it did when we scanned;
+	// any others wait their turn behind it
+	std::vector<Room*>& rooms = room_map[strlower(room->getId())].rooms;
+	if (std::find(rooms.begin(), rooms.end(), room) == rooms.end())
+		rooms.push_back(room);
+}
+
+void _MZone::unindexRoom(Room* room)
+{
+	assert(room != NULL);
+
+	RoomMap::iterator i = room_map.find(strlower(room->getId()));
+	if (i == room_map.end())
+		return;
+
+	// keep the entry itself, even if empty; portals point at it
+	std::vector<Room*>& rooms = i->second.rooms;
+	std::vector<Room*>::iterator r = std::find(rooms.begin(), rooms.end(), room);
+	if (r != rooms.end())
+		rooms.erase(r);
 }
 
 void Zone::announce(const std::string& str, AnnounceFlags flags) const
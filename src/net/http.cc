@@ -321,7 +321,7 @@ void HTTPHandler::parseRequestData(std::tr1::unordered_map<std::string, std::str
 void HTTPHandler::execute()
 {
 	// set up to run the Lua http_request hook handler
-	Lua::ExecHook exec("http_request");
+	Lua::ExecHook exec(Hooks::HTTP_REQUEST);
 
 	// build the 'req' table parameter
 	exec.table();
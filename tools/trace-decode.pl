@@ -0,0 +1,63 @@
+#!/usr/bin/env perl
+# Source MUD
+# Copyright (C) 2000-2005  Sean Middleditch
+# See the file COPYING for license details
+# http://www.sourcemud.org
+#
+# Prints a trace dump written by `admin trace dump', SIGUSR1 or a tick
+# overrun (see include/mud/trace.h).  Must be run on a machine with the
+# same byte order as the server.  Each line shows the time since the
+# first record, the time until the next record, and the record.
+#
+# usage: trace-decode.pl <dump>
+
+use strict;
+
+my @types = ('none', 'tick', 'tick-end', 'event', 'command', 'hook', 'gc');
+
+my $path = shift or die "usage: $0 <dump>\n";
+open(my $in, '<', $path) or die "$path: $!\n";
+binmode($in);
+
+sub readn {
+	my ($len) = @_;
+	my $buf = '';
+	return '' if $len == 0;
+	read($in, $buf, $len) == $len or die "$path: truncated\n";
+	return $buf;
+}
+
+readn(8) eq 'SMTRACE1' or die "$path: not a trace dump\n";
+my ($size, $nnames, $count) = unpack('L3', readn(12));
+$size == 16 or die "$path: unexpected record size $size\n";
+
+my @names;
+for (1 .. $nnames) {
+	my $len = unpack('S', readn(2));
+	push @names, readn($len);
+}
+
+my @records;
+for (1 .. $count) {
+	push @records, [ unpack('Q S S L', readn($size)) ];
+}
+
+for my $i (0 .. $#records) {
+	my ($nsecs, $type, $name, $arg) = @{$records[$i]};
+	my $since = ($nsecs - $records[0][0]) / 1000000;
+	my $delta = $i < $#records ? sprintf('%10.1fus', ($records[$i + 1][0] - $nsecs) / 1000) : ' ' x 12;
+	my $what = $types[$type] || "type$type";
+
+	my $detail;
+	if ($type == 1) {
+		$detail = "#$arg";
+	} elsif ($type == 2 || $type == 6) {
+		$detail = sprintf('%.3fms', $arg / 1000);
+	} elsif ($type == 3 || $type == 4) {
+		$detail = "$names[$name] slot=$arg";
+	} else {
+		$detail = $names[$name];
+	}
+
+	printf("%12.3fms %s  %-8s %s\n", $since, $delta, $what, $detail);
+}